@@ -0,0 +1,441 @@
+/*
+ * Copyright (c) 2026 Igalia S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Repeatedly creates and destroys views and toplevels, resizes them and
+ * switches between SHM and udmabuf buffers, then checks that open fds,
+ * buffer and texture instances and RSS stop growing once warmed up. It
+ * exits with a non-zero status when they don't. Like the frame benchmark
+ * it needs a display, and GOBJECT_DEBUG=instance-count for the instance
+ * checks.
+ */
+
+#define _GNU_SOURCE
+
+#include "wpe-display-gtk.h"
+#include "wpe-toplevel-gtk.h"
+#include "wpe-view-gtk.h"
+
+#include <fcntl.h>
+#include <linux/udmabuf.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define N_BUFFERS 3
+#define DRM_FORMAT_XRGB8888 0x34325258
+#define DRM_FORMAT_MOD_LINEAR 0
+#define FRAME_TIMEOUT_USEC (G_USEC_PER_SEC / 2)
+#define SETTLE_USEC (G_USEC_PER_SEC / 10)
+
+static int n_cycles = 40;
+static int n_warmup_cycles = 8;
+static int n_frames = 12;
+static int rss_tolerance = 8192;
+
+static const GOptionEntry option_entries[] = {
+  { "cycles", 'c', 0, G_OPTION_ARG_INT, &n_cycles, "Number of measured view cycles", "N" },
+  { "warmup", 'w', 0, G_OPTION_ARG_INT, &n_warmup_cycles, "Number of cycles run before taking the baseline", "N" },
+  { "frames", 'f', 0, G_OPTION_ARG_INT, &n_frames, "Frames rendered in each cycle", "N" },
+  { "rss-tolerance", 0, 0, G_OPTION_ARG_INT, &rss_tolerance, "Allowed RSS growth over the measured cycles", "KIB" },
+  { NULL }
+};
+
+static const struct {
+  int width;
+  int height;
+} sizes[] = {
+  { 640, 480 },
+  { 1280, 720 },
+  { 800, 600 },
+  { 1920, 1080 },
+  { 333, 777 }
+};
+
+typedef struct {
+  WPEBuffer *buffer;
+  guint8 *data;
+  gsize size;
+  gboolean is_dmabuf;
+  gboolean busy;
+  gboolean rendered;
+} FrameBuffer;
+
+typedef struct {
+  WPEDisplay *display;
+  WPEView *view;
+  GtkWindow *window;
+  WPEToplevel *toplevel;
+  FrameBuffer buffers[N_BUFFERS];
+  int width;
+  int height;
+  gboolean use_dmabuf;
+  guint max_busy_buffers;
+} Cycle;
+
+typedef struct {
+  guint n_fds;
+  guint n_buffers;
+  guint n_textures;
+  long rss;
+} Sample;
+
+static gboolean have_udmabuf = FALSE;
+static gboolean have_instance_count = FALSE;
+
+static guint process_fd_count(void)
+{
+  g_autoptr(GDir) dir = g_dir_open("/proc/self/fd", 0, NULL);
+  if (!dir)
+    return 0;
+
+  guint n_fds = 0;
+  while (g_dir_read_name(dir))
+    n_fds++;
+  return n_fds;
+}
+
+static long process_resident_size(void)
+{
+  g_autofree char *contents = NULL;
+  if (!g_file_get_contents("/proc/self/statm", &contents, NULL, NULL))
+    return 0;
+
+  long size, resident;
+  if (sscanf(contents, "%ld %ld", &size, &resident) != 2)
+    return 0;
+
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void sample_take(Sample *sample)
+{
+  sample->n_fds = process_fd_count();
+  sample->rss = process_resident_size();
+  if (!have_instance_count) {
+    sample->n_buffers = sample->n_textures = 0;
+    return;
+  }
+
+  sample->n_buffers = g_type_get_instance_count(WPE_TYPE_BUFFER_SHM) + g_type_get_instance_count(WPE_TYPE_BUFFER_DMA_BUF);
+  sample->n_textures = g_type_get_instance_count(GDK_TYPE_MEMORY_TEXTURE) + g_type_get_instance_count(GDK_TYPE_DMABUF_TEXTURE) + g_type_get_instance_count(GDK_TYPE_GL_TEXTURE);
+}
+
+static void wait_for(gboolean (*condition)(gpointer), gpointer user_data, gint64 timeout)
+{
+  gint64 deadline = g_get_monotonic_time() + timeout;
+  while (!(condition && condition(user_data)) && g_get_monotonic_time() < deadline) {
+    if (!g_main_context_iteration(NULL, FALSE))
+      g_usleep(1000);
+  }
+}
+
+static gboolean frame_buffer_init_dmabuf(FrameBuffer *frame_buffer, WPEDisplay *display, int width, int height)
+{
+  int udmabuf = open("/dev/udmabuf", O_RDWR | O_CLOEXEC);
+  if (udmabuf == -1)
+    return FALSE;
+
+  guint32 stride = width * 4;
+  gsize page_size = sysconf(_SC_PAGESIZE);
+  frame_buffer->size = (stride * height + page_size - 1) & ~(page_size - 1);
+
+  int memfd = memfd_create("wpe-soak", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (memfd == -1 || ftruncate(memfd, frame_buffer->size) == -1 || fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK) == -1) {
+    if (memfd != -1)
+      close(memfd);
+    close(udmabuf);
+    return FALSE;
+  }
+
+  struct udmabuf_create create = {
+    .memfd = memfd,
+    .flags = UDMABUF_FLAGS_CLOEXEC,
+    .offset = 0,
+    .size = frame_buffer->size
+  };
+  int fd = ioctl(udmabuf, UDMABUF_CREATE, &create);
+  close(udmabuf);
+  if (fd == -1) {
+    close(memfd);
+    return FALSE;
+  }
+
+  frame_buffer->data = mmap(NULL, frame_buffer->size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+  close(memfd);
+  if (frame_buffer->data == MAP_FAILED) {
+    frame_buffer->data = NULL;
+    close(fd);
+    return FALSE;
+  }
+
+  guint32 offset = 0;
+  frame_buffer->buffer = WPE_BUFFER(wpe_buffer_dma_buf_new(display, width, height, DRM_FORMAT_XRGB8888, 1, &fd, &offset, &stride, DRM_FORMAT_MOD_LINEAR));
+  frame_buffer->is_dmabuf = TRUE;
+  return TRUE;
+}
+
+static void frame_buffer_init_shm(FrameBuffer *frame_buffer, WPEDisplay *display, int width, int height)
+{
+  frame_buffer->size = width * 4 * height;
+  frame_buffer->data = g_malloc(frame_buffer->size);
+
+  // The view may still hold the buffer after it's dropped here, so the data
+  // belongs to the GBytes.
+  g_autoptr(GBytes) bytes = g_bytes_new_with_free_func(frame_buffer->data, frame_buffer->size, g_free, frame_buffer->data);
+  frame_buffer->buffer = WPE_BUFFER(wpe_buffer_shm_new(display, width, height, WPE_PIXEL_FORMAT_ARGB8888, bytes, width * 4));
+  frame_buffer->is_dmabuf = FALSE;
+}
+
+static void frame_buffer_clear(FrameBuffer *frame_buffer)
+{
+  g_clear_object(&frame_buffer->buffer);
+  if (frame_buffer->data && frame_buffer->is_dmabuf)
+    munmap(frame_buffer->data, frame_buffer->size);
+  memset(frame_buffer, 0, sizeof(FrameBuffer));
+}
+
+static FrameBuffer *cycle_find_frame_buffer(Cycle *cycle, WPEBuffer *buffer)
+{
+  for (guint i = 0; i < N_BUFFERS; i++) {
+    if (cycle->buffers[i].buffer == buffer)
+      return &cycle->buffers[i];
+  }
+  return NULL;
+}
+
+static void buffer_rendered_cb(WPEView *view, WPEBuffer *buffer, Cycle *cycle)
+{
+  FrameBuffer *frame_buffer = cycle_find_frame_buffer(cycle, buffer);
+  if (frame_buffer)
+    frame_buffer->rendered = TRUE;
+}
+
+static void buffer_released_cb(WPEView *view, WPEBuffer *buffer, Cycle *cycle)
+{
+  FrameBuffer *frame_buffer = cycle_find_frame_buffer(cycle, buffer);
+  if (frame_buffer)
+    frame_buffer->busy = FALSE;
+}
+
+static gboolean cycle_has_free_buffer(gpointer user_data)
+{
+  Cycle *cycle = user_data;
+  for (guint i = 0; i < N_BUFFERS; i++) {
+    if (!cycle->buffers[i].busy)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static gboolean frame_buffer_is_rendered(gpointer user_data)
+{
+  return ((FrameBuffer *)user_data)->rendered;
+}
+
+static gboolean cycle_view_has_size(gpointer user_data)
+{
+  Cycle *cycle = user_data;
+  return wpe_view_get_width(cycle->view) == cycle->width && wpe_view_get_height(cycle->view) == cycle->height;
+}
+
+static void cycle_set_buffers(Cycle *cycle, int width, int height, gboolean use_dmabuf)
+{
+  // Buffers still held by the view are released when their replacement is
+  // rendered, the same way WebKit swaps its swapchain on resize.
+  for (guint i = 0; i < N_BUFFERS; i++)
+    frame_buffer_clear(&cycle->buffers[i]);
+
+  cycle->width = width;
+  cycle->height = height;
+  cycle->use_dmabuf = use_dmabuf;
+  for (guint i = 0; i < N_BUFFERS; i++) {
+    if (use_dmabuf && frame_buffer_init_dmabuf(&cycle->buffers[i], cycle->display, width, height))
+      continue;
+    frame_buffer_init_shm(&cycle->buffers[i], cycle->display, width, height);
+  }
+}
+
+static void cycle_render_frame(Cycle *cycle, guint frame)
+{
+  wait_for(cycle_has_free_buffer, cycle, FRAME_TIMEOUT_USEC);
+
+  FrameBuffer *frame_buffer = NULL;
+  for (guint i = 0; i < N_BUFFERS && !frame_buffer; i++) {
+    if (!cycle->buffers[i].busy)
+      frame_buffer = &cycle->buffers[i];
+  }
+  if (!frame_buffer)
+    return;
+
+  memset(frame_buffer->data, frame * 16, frame_buffer->size);
+
+  // Every other frame only damages a corner, to go through the partial
+  // texture update path as well.
+  WPERectangle damage = { 0, 0, MIN(64, cycle->width), MIN(64, cycle->height) };
+  guint n_damage_rects = frame % 2;
+
+  frame_buffer->busy = TRUE;
+  frame_buffer->rendered = FALSE;
+  g_autoptr(GError) error = NULL;
+  if (!wpe_view_render_buffer(cycle->view, frame_buffer->buffer, n_damage_rects ? &damage : NULL, n_damage_rects, &error)) {
+    g_printerr("Failed to render buffer: %s\n", error->message);
+    frame_buffer->busy = FALSE;
+    return;
+  }
+
+  wait_for(frame_buffer_is_rendered, frame_buffer, FRAME_TIMEOUT_USEC);
+  if (!frame_buffer->rendered)
+    return;
+
+  // Buffers handed to the view and not released back yet.
+  guint n_busy_buffers = 0;
+  for (guint i = 0; i < N_BUFFERS; i++) {
+    if (cycle->buffers[i].busy)
+      n_busy_buffers++;
+  }
+  cycle->max_busy_buffers = MAX(cycle->max_busy_buffers, n_busy_buffers);
+}
+
+static gboolean cycle_run(WPEDisplay *display, guint index)
+{
+  Cycle cycle = { .display = display };
+  int width = sizes[index % G_N_ELEMENTS(sizes)].width;
+  int height = sizes[index % G_N_ELEMENTS(sizes)].height;
+
+  cycle.view = wpe_view_gtk_new(WPE_DISPLAY_GTK(display));
+  g_signal_connect(cycle.view, "buffer-rendered", G_CALLBACK(buffer_rendered_cb), &cycle);
+  g_signal_connect(cycle.view, "buffer-released", G_CALLBACK(buffer_released_cb), &cycle);
+
+  cycle.window = GTK_WINDOW(gtk_window_new());
+  gtk_window_set_default_size(cycle.window, width, height);
+  cycle.toplevel = wpe_toplevel_gtk_new(WPE_DISPLAY_GTK(display), 1, cycle.window);
+  wpe_view_set_toplevel(cycle.view, cycle.toplevel);
+
+  cycle_set_buffers(&cycle, width, height, have_udmabuf && index % 2);
+  wait_for(cycle_view_has_size, &cycle, FRAME_TIMEOUT_USEC);
+
+  for (int frame = 0; frame < n_frames; frame++) {
+    if (frame == n_frames / 2) {
+      int new_width = sizes[(index + 1) % G_N_ELEMENTS(sizes)].width;
+      int new_height = sizes[(index + 1) % G_N_ELEMENTS(sizes)].height;
+      gtk_window_set_default_size(cycle.window, new_width, new_height);
+      cycle_set_buffers(&cycle, new_width, new_height, have_udmabuf && !(index % 2));
+      wait_for(cycle_view_has_size, &cycle, FRAME_TIMEOUT_USEC);
+    }
+    cycle_render_frame(&cycle, frame);
+  }
+
+  g_signal_handlers_disconnect_by_data(cycle.view, &cycle);
+  wpe_view_set_toplevel(cycle.view, NULL);
+  g_object_unref(cycle.view);
+  g_object_unref(cycle.toplevel);
+  gtk_window_destroy(cycle.window);
+  for (guint i = 0; i < N_BUFFERS; i++)
+    frame_buffer_clear(&cycle.buffers[i]);
+
+  // Let GTK finish the pending frame and free the renderer resources.
+  wait_for(NULL, NULL, SETTLE_USEC);
+
+  // Once a frame is rendered, the view may only hold its pending and committed
+  // buffers, every other one must have been released.
+  if (cycle.max_busy_buffers > 2) {
+    g_printerr("cycle %u: %u buffers not released by the view\n", index, cycle.max_busy_buffers);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+int main(int argc, char **argv)
+{
+  g_autoptr(GOptionContext) context = g_option_context_new(NULL);
+  g_option_context_add_main_entries(context, option_entries, NULL);
+  g_autoptr(GError) error = NULL;
+  if (!g_option_context_parse(context, &argc, &argv, &error)) {
+    g_printerr("%s\n", error->message);
+    return 1;
+  }
+
+  if (n_cycles <= 0 || n_warmup_cycles < 0 || n_frames <= 0 || rss_tolerance < 0) {
+    g_printerr("Cycles and frames must be positive\n");
+    return 1;
+  }
+
+  g_autoptr(WPEDisplay) display = wpe_display_gtk_new();
+  if (!wpe_display_connect(display, &error)) {
+    g_printerr("Failed to connect to display: %s\n", error->message);
+    return 1;
+  }
+
+  have_udmabuf = !access("/dev/udmabuf", R_OK | W_OK);
+  if (!have_udmabuf)
+    g_printerr("udmabuf is not available, only SHM buffers are used\n");
+
+  // Instance counting can only be enabled before the type system starts.
+  have_instance_count = g_type_get_instance_count(WPE_TYPE_DISPLAY_GTK) > 0;
+  if (!have_instance_count)
+    g_printerr("GOBJECT_DEBUG=instance-count is not set, buffer and texture instances are not checked\n");
+
+  gboolean success = TRUE;
+  for (int i = 0; i < n_warmup_cycles && success; i++)
+    success = cycle_run(display, i);
+
+  Sample baseline;
+  sample_take(&baseline);
+
+  for (int i = 0; i < n_cycles && success; i++)
+    success = cycle_run(display, n_warmup_cycles + i);
+
+  Sample sample;
+  sample_take(&sample);
+
+  g_print("cycles: %d (+%d warm-up), frames per cycle: %d, buffers: %s\n",
+          n_cycles, n_warmup_cycles, n_frames, have_udmabuf ? "shm and dmabuf" : "shm");
+  g_print("fds: %u -> %u\n", baseline.n_fds, sample.n_fds);
+  if (have_instance_count) {
+    g_print("buffers: %u -> %u\n", baseline.n_buffers, sample.n_buffers);
+    g_print("textures: %u -> %u\n", baseline.n_textures, sample.n_textures);
+  }
+  g_print("rss: %ld KiB -> %ld KiB\n", baseline.rss, sample.rss);
+
+  if (sample.n_fds > baseline.n_fds) {
+    g_printerr("Leaked %u fds\n", sample.n_fds - baseline.n_fds);
+    success = FALSE;
+  }
+  if (sample.n_buffers > baseline.n_buffers) {
+    g_printerr("Leaked %u buffers\n", sample.n_buffers - baseline.n_buffers);
+    success = FALSE;
+  }
+  if (sample.n_textures > baseline.n_textures) {
+    g_printerr("Leaked %u textures\n", sample.n_textures - baseline.n_textures);
+    success = FALSE;
+  }
+  if (sample.rss - baseline.rss > rss_tolerance) {
+    g_printerr("RSS grew by %ld KiB\n", sample.rss - baseline.rss);
+    success = FALSE;
+  }
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,386 @@
+/*
+ * Copyright (c) 2026 Igalia S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Pushes synthetic frames through real WPEViewGtk views and reports the
+ * presented frame rate, dropped frames, CPU time per frame and RSS. It
+ * needs a display, so run it under Xvfb or a headless Wayland compositor,
+ * for example with LIBGL_ALWAYS_SOFTWARE=1 to use llvmpipe.
+ */
+
+#define _GNU_SOURCE
+
+#include "wpe-display-gtk.h"
+#include "wpe-toplevel-gtk.h"
+#include "wpe-view-gtk.h"
+
+#include <fcntl.h>
+#include <linux/udmabuf.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#define N_BUFFERS 3
+#define DRM_FORMAT_XRGB8888 0x34325258
+#define DRM_FORMAT_MOD_LINEAR 0
+
+static int width = 1920;
+static int height = 1080;
+static int rate = 60;
+static int n_views = 1;
+static int duration = 10;
+static char *damage = NULL;
+static gboolean use_dmabuf = FALSE;
+
+static const GOptionEntry option_entries[] = {
+  { "width", 'w', 0, G_OPTION_ARG_INT, &width, "Buffer width", "PIXELS" },
+  { "height", 'h', 0, G_OPTION_ARG_INT, &height, "Buffer height", "PIXELS" },
+  { "rate", 'r', 0, G_OPTION_ARG_INT, &rate, "Frames per second produced for each view", "FPS" },
+  { "views", 'n', 0, G_OPTION_ARG_INT, &n_views, "Number of views", "N" },
+  { "duration", 'd', 0, G_OPTION_ARG_INT, &duration, "Duration of the run", "SECONDS" },
+  { "damage", 0, 0, G_OPTION_ARG_STRING, &damage, "Damage pattern: full or partial (default: full)", "PATTERN" },
+  { "dmabuf", 0, 0, G_OPTION_ARG_NONE, &use_dmabuf, "Use udmabuf DMA-BUF buffers instead of SHM", NULL },
+  { NULL }
+};
+
+typedef enum {
+  DAMAGE_FULL,
+  DAMAGE_PARTIAL
+} DamagePattern;
+
+typedef struct {
+  WPEBuffer *buffer;
+  guint8 *data;
+  gsize size;
+  guint stride;
+  gboolean busy;
+  gboolean rendered;
+} FrameBuffer;
+
+typedef struct {
+  WPEView *view;
+  FrameBuffer buffers[N_BUFFERS];
+  guint frame;
+  guint presented_frames;
+  guint dropped_frames;
+  guint stalled_frames;
+} ViewProducer;
+
+static DamagePattern damage_pattern = DAMAGE_FULL;
+static gint64 producer_cpu_time = 0;
+
+static gint64 process_cpu_time(void)
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage))
+    return 0;
+
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * G_USEC_PER_SEC + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static gint64 thread_cpu_time(void)
+{
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+    return 0;
+
+  return ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+static long process_resident_size(void)
+{
+  g_autofree char *contents = NULL;
+  if (!g_file_get_contents("/proc/self/statm", &contents, NULL, NULL))
+    return 0;
+
+  long size, resident;
+  if (sscanf(contents, "%ld %ld", &size, &resident) != 2)
+    return 0;
+
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static gboolean frame_buffer_init_dmabuf(FrameBuffer *frame_buffer, WPEDisplay *display)
+{
+  int udmabuf = open("/dev/udmabuf", O_RDWR | O_CLOEXEC);
+  if (udmabuf == -1)
+    return FALSE;
+
+  frame_buffer->stride = width * 4;
+  gsize page_size = sysconf(_SC_PAGESIZE);
+  frame_buffer->size = (frame_buffer->stride * height + page_size - 1) & ~(page_size - 1);
+
+  int memfd = memfd_create("wpe-benchmark", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (memfd == -1 || ftruncate(memfd, frame_buffer->size) == -1 || fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK) == -1) {
+    if (memfd != -1)
+      close(memfd);
+    close(udmabuf);
+    return FALSE;
+  }
+
+  struct udmabuf_create create = {
+    .memfd = memfd,
+    .flags = UDMABUF_FLAGS_CLOEXEC,
+    .offset = 0,
+    .size = frame_buffer->size
+  };
+  int fd = ioctl(udmabuf, UDMABUF_CREATE, &create);
+  close(udmabuf);
+  if (fd == -1) {
+    close(memfd);
+    return FALSE;
+  }
+
+  frame_buffer->data = mmap(NULL, frame_buffer->size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+  close(memfd);
+  if (frame_buffer->data == MAP_FAILED) {
+    frame_buffer->data = NULL;
+    close(fd);
+    return FALSE;
+  }
+
+  guint32 offset = 0;
+  guint32 stride = frame_buffer->stride;
+  frame_buffer->buffer = WPE_BUFFER(wpe_buffer_dma_buf_new(display, width, height, DRM_FORMAT_XRGB8888, 1, &fd, &offset, &stride, DRM_FORMAT_MOD_LINEAR));
+  return TRUE;
+}
+
+static void frame_buffer_init_shm(FrameBuffer *frame_buffer, WPEDisplay *display)
+{
+  frame_buffer->stride = width * 4;
+  frame_buffer->size = frame_buffer->stride * height;
+  frame_buffer->data = g_malloc0(frame_buffer->size);
+
+  // The GBytes doesn't own the data, so that frames can be written in place.
+  g_autoptr(GBytes) bytes = g_bytes_new_static(frame_buffer->data, frame_buffer->size);
+  frame_buffer->buffer = WPE_BUFFER(wpe_buffer_shm_new(display, width, height, WPE_PIXEL_FORMAT_ARGB8888, bytes, frame_buffer->stride));
+}
+
+static void frame_buffer_clear(FrameBuffer *frame_buffer)
+{
+  g_clear_object(&frame_buffer->buffer);
+  if (!frame_buffer->data)
+    return;
+
+  if (use_dmabuf)
+    munmap(frame_buffer->data, frame_buffer->size);
+  else
+    g_free(frame_buffer->data);
+  frame_buffer->data = NULL;
+}
+
+static FrameBuffer *view_producer_find_frame_buffer(ViewProducer *producer, WPEBuffer *buffer)
+{
+  for (guint i = 0; i < N_BUFFERS; i++) {
+    if (producer->buffers[i].buffer == buffer)
+      return &producer->buffers[i];
+  }
+  return NULL;
+}
+
+static void buffer_rendered_cb(WPEView *view, WPEBuffer *buffer, ViewProducer *producer)
+{
+  FrameBuffer *frame_buffer = view_producer_find_frame_buffer(producer, buffer);
+  if (!frame_buffer)
+    return;
+
+  frame_buffer->rendered = TRUE;
+  producer->presented_frames++;
+}
+
+static void buffer_released_cb(WPEView *view, WPEBuffer *buffer, ViewProducer *producer)
+{
+  FrameBuffer *frame_buffer = view_producer_find_frame_buffer(producer, buffer);
+  if (!frame_buffer)
+    return;
+
+  if (!frame_buffer->rendered)
+    producer->dropped_frames++;
+  frame_buffer->busy = FALSE;
+}
+
+static void fill_rect(FrameBuffer *frame_buffer, const WPERectangle *rect, guint32 color)
+{
+  for (int y = rect->y; y < rect->y + rect->height; y++) {
+    guint32 *row = (guint32 *)(frame_buffer->data + y * frame_buffer->stride);
+    for (int x = rect->x; x < rect->x + rect->width; x++)
+      row[x] = color;
+  }
+}
+
+static gboolean view_producer_tick(ViewProducer *producer)
+{
+  FrameBuffer *frame_buffer = NULL;
+  for (guint i = 0; i < N_BUFFERS && !frame_buffer; i++) {
+    if (!producer->buffers[i].busy)
+      frame_buffer = &producer->buffers[i];
+  }
+  if (!frame_buffer) {
+    producer->stalled_frames++;
+    return G_SOURCE_CONTINUE;
+  }
+
+  // Writing the pixels is the producer's work, not the platform's, it's
+  // measured to be left out of the CPU time per frame.
+  gint64 start_time = thread_cpu_time();
+  guint frame = producer->frame++;
+  guint32 color = 0xff000000 | ((frame * 2654435761u) & 0x00ffffff);
+  WPERectangle rect = { 0, 0, width, height };
+  guint n_damage_rects = 0;
+  switch (damage_pattern) {
+  case DAMAGE_FULL:
+    fill_rect(frame_buffer, &rect, color);
+    break;
+  case DAMAGE_PARTIAL:
+    // A small moving square, like a spinner or a blinking caret. Buffers are
+    // reused, so the whole frame is filled once before relying on damage.
+    if (frame < N_BUFFERS)
+      fill_rect(frame_buffer, &rect, 0xffffffff);
+    else {
+      rect.width = MIN(64, width);
+      rect.height = MIN(64, height);
+      rect.x = (frame * 8) % (width - rect.width + 1);
+      rect.y = (frame * 4) % (height - rect.height + 1);
+      fill_rect(frame_buffer, &rect, color);
+      n_damage_rects = 1;
+    }
+    break;
+  }
+  producer_cpu_time += thread_cpu_time() - start_time;
+
+  frame_buffer->busy = TRUE;
+  frame_buffer->rendered = FALSE;
+  g_autoptr(GError) error = NULL;
+  if (!wpe_view_render_buffer(producer->view, frame_buffer->buffer, n_damage_rects ? &rect : NULL, n_damage_rects, &error)) {
+    g_printerr("Failed to render buffer: %s\n", error->message);
+    frame_buffer->busy = FALSE;
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean quit_cb(GMainLoop *loop)
+{
+  g_main_loop_quit(loop);
+  return G_SOURCE_REMOVE;
+}
+
+int main(int argc, char **argv)
+{
+  g_autoptr(GOptionContext) context = g_option_context_new(NULL);
+  g_option_context_add_main_entries(context, option_entries, NULL);
+  g_autoptr(GError) error = NULL;
+  if (!g_option_context_parse(context, &argc, &argv, &error)) {
+    g_printerr("%s\n", error->message);
+    return 1;
+  }
+
+  if (width <= 0 || height <= 0 || rate <= 0 || n_views <= 0 || duration <= 0) {
+    g_printerr("Sizes, rate, views and duration must be positive\n");
+    return 1;
+  }
+
+  if (!damage || !g_strcmp0(damage, "full"))
+    damage_pattern = DAMAGE_FULL;
+  else if (!g_strcmp0(damage, "partial"))
+    damage_pattern = DAMAGE_PARTIAL;
+  else {
+    g_printerr("Unknown damage pattern: %s\n", damage);
+    return 1;
+  }
+
+  g_autoptr(WPEDisplay) display = wpe_display_gtk_new();
+  if (!wpe_display_connect(display, &error)) {
+    g_printerr("Failed to connect to display: %s\n", error->message);
+    return 1;
+  }
+
+  if (use_dmabuf && access("/dev/udmabuf", R_OK | W_OK)) {
+    g_printerr("udmabuf is not available, using SHM buffers\n");
+    use_dmabuf = FALSE;
+  }
+
+  ViewProducer *producers = g_new0(ViewProducer, n_views);
+  for (int i = 0; i < n_views; i++) {
+    ViewProducer *producer = &producers[i];
+    producer->view = wpe_view_gtk_new(WPE_DISPLAY_GTK(display));
+    g_signal_connect(producer->view, "buffer-rendered", G_CALLBACK(buffer_rendered_cb), producer);
+    g_signal_connect(producer->view, "buffer-released", G_CALLBACK(buffer_released_cb), producer);
+
+    GtkWindow *window = GTK_WINDOW(gtk_window_new());
+    gtk_window_set_default_size(window, width, height);
+    g_autoptr(WPEToplevel) toplevel = wpe_toplevel_gtk_new(WPE_DISPLAY_GTK(display), 1, window);
+    wpe_view_set_toplevel(producer->view, toplevel);
+
+    for (guint j = 0; j < N_BUFFERS; j++) {
+      if (!use_dmabuf) {
+        frame_buffer_init_shm(&producer->buffers[j], display);
+        continue;
+      }
+
+      if (!frame_buffer_init_dmabuf(&producer->buffers[j], display)) {
+        g_printerr("Failed to create udmabuf buffer\n");
+        return 1;
+      }
+    }
+  }
+
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+  for (int i = 0; i < n_views; i++)
+    g_timeout_add_full(G_PRIORITY_DEFAULT, 1000 / rate, (GSourceFunc)view_producer_tick, &producers[i], NULL);
+  g_timeout_add_seconds(duration, (GSourceFunc)quit_cb, loop);
+
+  gint64 start_time = g_get_monotonic_time();
+  gint64 start_cpu_time = process_cpu_time();
+  g_main_loop_run(loop);
+  gint64 elapsed = g_get_monotonic_time() - start_time;
+  gint64 cpu_time = process_cpu_time() - start_cpu_time - producer_cpu_time;
+
+  guint presented_frames = 0, dropped_frames = 0, stalled_frames = 0;
+  for (int i = 0; i < n_views; i++) {
+    presented_frames += producers[i].presented_frames;
+    dropped_frames += producers[i].dropped_frames;
+    stalled_frames += producers[i].stalled_frames;
+  }
+
+  g_print("buffers: %s, size: %dx%d, damage: %s, views: %d, target rate: %d fps\n",
+          use_dmabuf ? "dmabuf" : "shm", width, height, damage ? damage : "full", n_views, rate);
+  g_print("presented: %.1f fps per view (%u frames)\n", presented_frames * (double)G_USEC_PER_SEC / elapsed / n_views, presented_frames);
+  g_print("dropped: %u frames, stalled: %u frames\n", dropped_frames, stalled_frames);
+  g_print("cpu: %.3f ms per presented frame, excluding %.3f ms writing the frames\n",
+          presented_frames ? cpu_time / 1000. / presented_frames : 0., presented_frames ? producer_cpu_time / 1000. / presented_frames : 0.);
+  g_print("rss: %ld KiB\n", process_resident_size());
+
+  for (int i = 0; i < n_views; i++) {
+    wpe_view_set_toplevel(producers[i].view, NULL);
+    g_object_unref(producers[i].view);
+    for (guint j = 0; j < N_BUFFERS; j++)
+      frame_buffer_clear(&producers[i].buffers[j]);
+  }
+  g_free(producers);
+
+  return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2026 Igalia S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "wpe-clipboard-content-provider-gtk.h"
+
+struct _WPEClipboardContentProviderGtk {
+  GdkContentProvider parent;
+
+  GdkContentFormats *formats;
+  WPEClipboardContent *content;
+};
+
+G_DEFINE_FINAL_TYPE(WPEClipboardContentProviderGtk, wpe_clipboard_content_provider_gtk, GDK_TYPE_CONTENT_PROVIDER)
+
+static void wpe_clipboard_content_provider_gtk_finalize(GObject *object)
+{
+  WPEClipboardContentProviderGtk *provider_gtk = WPE_CLIPBOARD_CONTENT_PROVIDER_GTK(object);
+  g_clear_pointer(&provider_gtk->formats, gdk_content_formats_unref);
+  g_clear_pointer(&provider_gtk->content, wpe_clipboard_content_unref);
+
+  G_OBJECT_CLASS(wpe_clipboard_content_provider_gtk_parent_class)->finalize(object);
+}
+
+static GdkContentFormats *wpe_clipboard_content_provider_gtk_ref_formats(GdkContentProvider *provider)
+{
+  return gdk_content_formats_ref(WPE_CLIPBOARD_CONTENT_PROVIDER_GTK(provider)->formats);
+}
+
+static void write_all_cb(GOutputStream *stream, GAsyncResult *result, GTask *task)
+{
+  GError *error = NULL;
+  if (g_output_stream_write_all_finish(stream, result, NULL, &error))
+    g_task_return_boolean(task, TRUE);
+  else
+    g_task_return_error(task, error);
+  g_object_unref(task);
+}
+
+static void wpe_clipboard_content_provider_gtk_write_mime_type_async(GdkContentProvider *provider, const char *mime_type, GOutputStream *stream, int io_priority, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+  WPEClipboardContentProviderGtk *provider_gtk = WPE_CLIPBOARD_CONTENT_PROVIDER_GTK(provider);
+
+  GTask *task = g_task_new(provider, cancellable, callback, user_data);
+  g_task_set_priority(task, io_priority);
+  g_task_set_source_tag(task, wpe_clipboard_content_provider_gtk_write_mime_type_async);
+
+  GBytes *bytes = gdk_content_formats_contain_mime_type(provider_gtk->formats, mime_type) ? wpe_clipboard_content_get_bytes(provider_gtk->content, mime_type) : NULL;
+  if (!bytes) {
+    g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Cannot provide contents as \"%s\"", mime_type);
+    g_object_unref(task);
+    return;
+  }
+
+  g_task_set_task_data(task, g_bytes_ref(bytes), (GDestroyNotify)g_bytes_unref);
+  gsize size;
+  gconstpointer data = g_bytes_get_data(bytes, &size);
+  g_output_stream_write_all_async(stream, data, size, io_priority, cancellable, (GAsyncReadyCallback)write_all_cb, task);
+}
+
+static gboolean wpe_clipboard_content_provider_gtk_write_mime_type_finish(GdkContentProvider *provider, GAsyncResult *result, GError **error)
+{
+  g_return_val_if_fail(g_task_is_valid(result, provider), FALSE);
+
+  return g_task_propagate_boolean(G_TASK(result), error);
+}
+
+static gboolean wpe_clipboard_content_provider_gtk_get_value(GdkContentProvider *provider, GValue *value, GError **error)
+{
+  WPEClipboardContentProviderGtk *provider_gtk = WPE_CLIPBOARD_CONTENT_PROVIDER_GTK(provider);
+  if (G_VALUE_HOLDS(value, G_TYPE_STRING) && gdk_content_formats_contain_gtype(provider_gtk->formats, G_TYPE_STRING)) {
+    g_value_set_string(value, wpe_clipboard_content_get_text(provider_gtk->content));
+    return TRUE;
+  }
+
+  return GDK_CONTENT_PROVIDER_CLASS(wpe_clipboard_content_provider_gtk_parent_class)->get_value(provider, value, error);
+}
+
+static void wpe_clipboard_content_provider_gtk_class_init(WPEClipboardContentProviderGtkClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS(klass);
+  object_class->finalize = wpe_clipboard_content_provider_gtk_finalize;
+
+  GdkContentProviderClass *provider_class = GDK_CONTENT_PROVIDER_CLASS(klass);
+  provider_class->ref_formats = wpe_clipboard_content_provider_gtk_ref_formats;
+  provider_class->write_mime_type_async = wpe_clipboard_content_provider_gtk_write_mime_type_async;
+  provider_class->write_mime_type_finish = wpe_clipboard_content_provider_gtk_write_mime_type_finish;
+  provider_class->get_value = wpe_clipboard_content_provider_gtk_get_value;
+}
+
+static void wpe_clipboard_content_provider_gtk_init(WPEClipboardContentProviderGtk *provider_gtk)
+{
+}
+
+GdkContentProvider *wpe_clipboard_content_provider_gtk_new(GPtrArray *formats, WPEClipboardContent *content)
+{
+  g_return_val_if_fail(formats, NULL);
+  g_return_val_if_fail(content, NULL);
+
+  WPEClipboardContentProviderGtk *provider_gtk = WPE_CLIPBOARD_CONTENT_PROVIDER_GTK(g_object_new(WPE_TYPE_CLIPBOARD_CONTENT_PROVIDER_GTK, NULL));
+  provider_gtk->content = wpe_clipboard_content_ref(content);
+
+  GdkContentFormatsBuilder *builder = gdk_content_formats_builder_new();
+  for (guint i = 0; formats->pdata[i]; i++) {
+    const char *internal_format = g_intern_string(formats->pdata[i]);
+    if (internal_format == g_intern_static_string("text/plain") || internal_format == g_intern_static_string("text/plain;charset=utf-8"))
+      gdk_content_formats_builder_add_gtype(builder, G_TYPE_STRING);
+    else if (wpe_clipboard_content_get_bytes(content, internal_format))
+      gdk_content_formats_builder_add_mime_type(builder, internal_format);
+  }
+  provider_gtk->formats = gdk_content_formats_builder_free_to_formats(builder);
+
+  return GDK_CONTENT_PROVIDER(provider_gtk);
+}
@@ -22,71 +22,309 @@
 
 #include "wpe-clipboard-gtk.h"
 
+#include "wpe-clipboard-content-provider-gtk.h"
+
+enum {
+  PROP_0,
+
+  PROP_PREFETCH_TEXT,
+
+  N_PROPS
+};
+
+static GParamSpec *properties[N_PROPS];
+
 struct _WPEClipboardGtk {
   WPEClipboard parent;
 
   GdkClipboard *clipboard;
+  GHashTable *cache;
+  gsize cache_size;
+  GHashTable *reads;
+  guint64 serial;
+  gboolean prefetch_text;
+  GCancellable *prefetch_cancellable;
 };
 
 G_DEFINE_FINAL_TYPE(WPEClipboardGtk, wpe_clipboard_gtk, WPE_TYPE_CLIPBOARD)
 
+static void wpe_clipboard_gtk_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+  WPEClipboardGtk *clipboard_gtk = WPE_CLIPBOARD_GTK(object);
+  switch (prop_id) {
+  case PROP_PREFETCH_TEXT:
+    wpe_clipboard_gtk_set_prefetch_text(clipboard_gtk, g_value_get_boolean(value));
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+  }
+}
+
+static void wpe_clipboard_gtk_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+  WPEClipboardGtk *clipboard_gtk = WPE_CLIPBOARD_GTK(object);
+  switch (prop_id) {
+  case PROP_PREFETCH_TEXT:
+    g_value_set_boolean(value, clipboard_gtk->prefetch_text);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+  }
+}
+
 static void wpe_clipboard_gtk_finalize(GObject *object)
 {
   WPEClipboardGtk *clipboard_gtk = WPE_CLIPBOARD_GTK(object);
   g_signal_handlers_disconnect_by_data(clipboard_gtk->clipboard, clipboard_gtk);
   g_clear_object(&clipboard_gtk->clipboard);
+  g_clear_pointer(&clipboard_gtk->cache, g_hash_table_unref);
+  g_clear_pointer(&clipboard_gtk->reads, g_hash_table_unref);
+  if (clipboard_gtk->prefetch_cancellable) {
+    g_cancellable_cancel(clipboard_gtk->prefetch_cancellable);
+    g_object_unref(clipboard_gtk->prefetch_cancellable);
+  }
 
   G_OBJECT_CLASS(wpe_clipboard_gtk_parent_class)->finalize(object);
 }
 
+#define CLIPBOARD_READ_CHUNK_SIZE 65536
+#define CLIPBOARD_READ_TIMEOUT_MS 500
+#define CLIPBOARD_CACHE_MAX_SIZE (8 * 1024 * 1024)
+
+// A read of one format from the GDK clipboard, shared by every request for
+// that format made while it's in flight.
 typedef struct {
-  GMainLoop *loop;
-  GInputStream *in_stream;
-} ReadAsyncData;
+  WPEClipboardGtk *clipboard;
+  const char *format;
+  guint64 serial;
+  GInputStream *stream;
+  GCancellable *cancellable;
+  guint timeout_id;
+  guint8 *data;
+  gsize size;
+  gsize allocated;
+  GList *tasks;
+} ReadOperation;
+
+typedef struct {
+  ReadOperation *operation;
+  GCancellable *cancellable;
+  gulong cancelled_id;
+} ReadTaskData;
 
-static void read_async_cb(GdkClipboard *clipboard, GAsyncResult *result, ReadAsyncData *data)
+static void read_task_data_free(ReadTaskData *data)
+{
+  if (data->cancellable) {
+    g_cancellable_disconnect(data->cancellable, data->cancelled_id);
+    g_object_unref(data->cancellable);
+  }
+  g_free(data);
+}
+
+static void read_operation_free(ReadOperation *operation)
+{
+  g_clear_handle_id(&operation->timeout_id, g_source_remove);
+  g_clear_object(&operation->stream);
+  g_clear_object(&operation->cancellable);
+  g_free(operation->data);
+  g_object_unref(operation->clipboard);
+  g_free(operation);
+}
+
+static void read_operation_finish(ReadOperation *operation, GBytes *bytes, GError *error)
+{
+  WPEClipboardGtk *clipboard_gtk = operation->clipboard;
+  if (g_hash_table_lookup(clipboard_gtk->reads, operation->format) == operation)
+    g_hash_table_remove(clipboard_gtk->reads, operation->format);
+
+  if (bytes && operation->serial == clipboard_gtk->serial && clipboard_gtk->cache_size + g_bytes_get_size(bytes) <= CLIPBOARD_CACHE_MAX_SIZE) {
+    g_hash_table_insert(clipboard_gtk->cache, (gpointer)operation->format, g_bytes_ref(bytes));
+    clipboard_gtk->cache_size += g_bytes_get_size(bytes);
+  }
+
+  GList *tasks = g_steal_pointer(&operation->tasks);
+  for (GList *l = tasks; l; l = g_list_next(l)) {
+    GTask *task = l->data;
+    ReadTaskData *data = g_task_get_task_data(task);
+    data->operation = NULL;
+    if (bytes)
+      g_task_return_pointer(task, g_bytes_ref(bytes), (GDestroyNotify)g_bytes_unref);
+    else
+      g_task_return_error(task, g_error_copy(error));
+    g_object_unref(task);
+  }
+  g_list_free(tasks);
+
+  if (bytes)
+    g_bytes_unref(bytes);
+  if (error)
+    g_error_free(error);
+  read_operation_free(operation);
+}
+
+static gboolean read_timeout_cb(ReadOperation *operation)
+{
+  operation->timeout_id = 0;
+  g_cancellable_cancel(operation->cancellable);
+  return G_SOURCE_REMOVE;
+}
+
+static void read_operation_rearm_timeout(ReadOperation *operation)
+{
+  g_clear_handle_id(&operation->timeout_id, g_source_remove);
+  operation->timeout_id = g_timeout_add(CLIPBOARD_READ_TIMEOUT_MS, (GSourceFunc)read_timeout_cb, operation);
+}
+
+static void stream_read_cb(GInputStream *stream, GAsyncResult *result, ReadOperation *operation);
+
+static void read_next_chunk(ReadOperation *operation)
+{
+  if (operation->size == operation->allocated) {
+    operation->allocated = MAX(operation->allocated * 2, CLIPBOARD_READ_CHUNK_SIZE);
+    operation->data = g_realloc(operation->data, operation->allocated);
+  }
+
+  read_operation_rearm_timeout(operation);
+  g_input_stream_read_async(operation->stream, operation->data + operation->size, operation->allocated - operation->size, G_PRIORITY_DEFAULT, operation->cancellable, (GAsyncReadyCallback)stream_read_cb, operation);
+}
+
+static void stream_read_cb(GInputStream *stream, GAsyncResult *result, ReadOperation *operation)
 {
   GError *error = NULL;
-  data->in_stream = gdk_clipboard_read_finish(clipboard, result, NULL, &error);
-  g_main_loop_quit(data->loop);
+  gssize n_read = g_input_stream_read_finish(stream, result, &error);
+  if (n_read == -1) {
+    read_operation_finish(operation, NULL, error);
+    return;
+  }
+
+  if (n_read > 0) {
+    operation->size += n_read;
+    read_next_chunk(operation);
+    return;
+  }
+
+  if (operation->allocated - operation->size > CLIPBOARD_READ_CHUNK_SIZE)
+    operation->data = g_realloc(operation->data, operation->size);
+  gsize size = operation->size;
+  operation->size = operation->allocated = 0;
+  read_operation_finish(operation, g_bytes_new_take(g_steal_pointer(&operation->data), size), NULL);
+}
+
+static void clipboard_read_cb(GdkClipboard *clipboard, GAsyncResult *result, ReadOperation *operation)
+{
+  GError *error = NULL;
+  operation->stream = gdk_clipboard_read_finish(clipboard, result, NULL, &error);
+  if (!operation->stream) {
+    read_operation_finish(operation, NULL, error);
+    return;
+  }
+
+  read_next_chunk(operation);
 }
 
-static gboolean read_timeout_cb(GCancellable *cancellable)
+static ReadOperation *read_operation_start(WPEClipboardGtk *clipboard, const char *format, gsize size_hint)
 {
-  g_cancellable_cancel(cancellable);
+  ReadOperation *operation = g_new0(ReadOperation, 1);
+  operation->clipboard = g_object_ref(clipboard);
+  operation->format = format;
+  operation->serial = clipboard->serial;
+  operation->cancellable = g_cancellable_new();
+  if (size_hint) {
+    operation->allocated = size_hint + 1;
+    operation->data = g_malloc(operation->allocated);
+  }
+  g_hash_table_insert(clipboard->reads, (gpointer)format, operation);
+
+  read_operation_rearm_timeout(operation);
+  const char *mime_types[] = { format, NULL };
+  gdk_clipboard_read_async(clipboard->clipboard, mime_types, G_PRIORITY_DEFAULT, operation->cancellable, (GAsyncReadyCallback)clipboard_read_cb, operation);
+  return operation;
+}
+
+static gboolean read_task_cancelled_idle(GTask *task)
+{
+  ReadTaskData *data = g_task_get_task_data(task);
+  ReadOperation *operation = g_steal_pointer(&data->operation);
+  if (!operation)
+    return G_SOURCE_REMOVE;
+
+  // The shared read is only cancelled once nobody is waiting for it.
+  operation->tasks = g_list_remove(operation->tasks, task);
+  if (!operation->tasks)
+    g_cancellable_cancel(operation->cancellable);
+
+  g_task_return_error_if_cancelled(task);
+  g_object_unref(task);
   return G_SOURCE_REMOVE;
 }
 
-static GBytes *wpe_clipboard_gtk_read(WPEClipboard *clipboard, const char *format)
+static void task_cancelled_cb(GCancellable *cancellable, GTask *task)
 {
-  WPEClipboardGtk *clipboard_gtk = WPE_CLIPBOARD_GTK(clipboard);
+  // The task can't be completed from the handler, since that would disconnect it.
+  g_idle_add_full(G_PRIORITY_DEFAULT, (GSourceFunc)read_task_cancelled_idle, g_object_ref(task), g_object_unref);
+}
 
-  GCancellable *cancellable = g_cancellable_new();
-  GMainLoop *loop = g_main_loop_new(NULL, FALSE);
-  guint timeout_source_id = g_timeout_add(500, (GSourceFunc)read_timeout_cb, cancellable);
+void wpe_clipboard_gtk_read_async(WPEClipboardGtk *clipboard, const char *format, gsize size_hint, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+  g_return_if_fail(WPE_IS_CLIPBOARD_GTK(clipboard));
+  g_return_if_fail(format);
 
-  ReadAsyncData data = { loop, NULL };
-  const char* mimeTypes[] = { format, NULL };
-  gdk_clipboard_read_async(clipboard_gtk->clipboard, mimeTypes, G_PRIORITY_DEFAULT, cancellable, (GAsyncReadyCallback)read_async_cb, &data);
+  GTask *task = g_task_new(clipboard, cancellable, callback, user_data);
+  g_task_set_source_tag(task, wpe_clipboard_gtk_read_async);
+  if (g_task_return_error_if_cancelled(task)) {
+    g_object_unref(task);
+    return;
+  }
 
-  g_main_loop_run(loop);
+  const char *internal_format = g_intern_string(format);
+  GBytes *bytes = g_hash_table_lookup(clipboard->cache, internal_format);
+  if (bytes) {
+    g_task_return_pointer(task, g_bytes_ref(bytes), (GDestroyNotify)g_bytes_unref);
+    g_object_unref(task);
+    return;
+  }
 
-  g_clear_handle_id(&timeout_source_id, g_source_remove);
-  g_object_unref(cancellable);
-  g_main_loop_unref(loop);
+  ReadOperation *operation = g_hash_table_lookup(clipboard->reads, internal_format);
+  if (!operation)
+    operation = read_operation_start(clipboard, internal_format, size_hint);
 
-  if (!data.in_stream)
-    return NULL;
+  ReadTaskData *data = g_new0(ReadTaskData, 1);
+  data->operation = operation;
+  g_task_set_task_data(task, data, (GDestroyNotify)read_task_data_free);
+  operation->tasks = g_list_append(operation->tasks, task);
+  if (cancellable) {
+    data->cancellable = g_object_ref(cancellable);
+    data->cancelled_id = g_cancellable_connect(cancellable, G_CALLBACK(task_cancelled_cb), task, NULL);
+  }
+}
 
-  GOutputStream *out_stream = g_memory_output_stream_new_resizable();
-  gssize result = g_output_stream_splice(out_stream, data.in_stream, G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET, NULL, NULL);
-  g_object_unref(data.in_stream);
-  if (result == -1)
-    return NULL;
+GBytes *wpe_clipboard_gtk_read_finish(WPEClipboardGtk *clipboard, GAsyncResult *result, GError **error)
+{
+  g_return_val_if_fail(WPE_IS_CLIPBOARD_GTK(clipboard), NULL);
+  g_return_val_if_fail(g_task_is_valid(result, clipboard), NULL);
 
-  GBytes *bytes = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(out_stream));
-  g_object_unref(out_stream);
-  return bytes;
+  return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  GBytes *bytes;
+} ReadSyncData;
+
+static void read_sync_cb(WPEClipboardGtk *clipboard_gtk, GAsyncResult *result, ReadSyncData *data)
+{
+  data->bytes = wpe_clipboard_gtk_read_finish(clipboard_gtk, result, NULL);
+  g_main_loop_quit(data->loop);
+}
+
+static GBytes *wpe_clipboard_gtk_read(WPEClipboard *clipboard, const char *format)
+{
+  ReadSyncData data = { g_main_loop_new(NULL, FALSE), NULL };
+  wpe_clipboard_gtk_read_async(WPE_CLIPBOARD_GTK(clipboard), format, 0, NULL, (GAsyncReadyCallback)read_sync_cb, &data);
+  g_main_loop_run(data.loop);
+  g_main_loop_unref(data.loop);
+
+  return data.bytes;
 }
 
 static void wpe_clipboard_gtk_changed(WPEClipboard *clipboard, GPtrArray *formats, gboolean is_local, WPEClipboardContent *content)
@@ -94,28 +332,7 @@ static void wpe_clipboard_gtk_changed(WPEClipboard *clipboard, GPtrArray *format
   WPEClipboardGtk *clipboard_gtk = WPE_CLIPBOARD_GTK(clipboard);
 
   if (is_local) {
-    GdkContentProvider *provider = NULL;
-    if (formats) {
-      GPtrArray *providers = g_ptr_array_sized_new(formats->len);
-      gboolean textAdded = FALSE;
-      for (unsigned i = 0; formats->pdata[i]; ++i) {
-        const char* internal_format = g_intern_string(formats->pdata[i]);
-        if (internal_format == g_intern_static_string("text/plain") || internal_format == g_intern_static_string("text/plain;charset=utf-8")) {
-          if (!textAdded) {
-            g_ptr_array_add(providers, gdk_content_provider_new_typed(G_TYPE_STRING, wpe_clipboard_content_get_text(content)));
-            textAdded = TRUE;
-          }
-        } else {
-          GBytes *bytes = wpe_clipboard_content_get_bytes(content, formats->pdata[i]);
-          if (bytes)
-            g_ptr_array_add(providers, gdk_content_provider_new_for_bytes(formats->pdata[i], bytes));
-        }
-      }
-
-      provider = gdk_content_provider_new_union((GdkContentProvider **)providers->pdata, providers->len);
-      g_ptr_array_unref(providers);
-    }
-
+    GdkContentProvider *provider = formats ? wpe_clipboard_content_provider_gtk_new(formats, content) : NULL;
     gdk_clipboard_set_content(clipboard_gtk->clipboard, provider);
     g_clear_object(&provider);
   }
@@ -126,8 +343,18 @@ static void wpe_clipboard_gtk_changed(WPEClipboard *clipboard, GPtrArray *format
 static void wpe_clipboard_gtk_class_init(WPEClipboardGtkClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS(klass);
+  object_class->set_property = wpe_clipboard_gtk_set_property;
+  object_class->get_property = wpe_clipboard_gtk_get_property;
   object_class->finalize = wpe_clipboard_gtk_finalize;
 
+  properties[PROP_PREFETCH_TEXT] =
+    g_param_spec_boolean("prefetch-text",
+                         NULL, NULL,
+                         FALSE,
+                         (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_EXPLICIT_NOTIFY));
+
+  g_object_class_install_properties(object_class, N_PROPS, properties);
+
   WPEClipboardClass* clipboard_class = WPE_CLIPBOARD_CLASS(klass);
   clipboard_class->read = wpe_clipboard_gtk_read;
   clipboard_class->changed = wpe_clipboard_gtk_changed;
@@ -135,12 +362,49 @@ static void wpe_clipboard_gtk_class_init(WPEClipboardGtkClass *klass)
 
 static void wpe_clipboard_gtk_init(WPEClipboardGtk *clipboard_gtk)
 {
+  clipboard_gtk->cache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_bytes_unref);
+  clipboard_gtk->reads = g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+static void wpe_clipboard_gtk_prefetch_text(WPEClipboardGtk *clipboard_gtk, GdkContentFormats *formats)
+{
+  const char *format = NULL;
+  if (gdk_content_formats_contain_mime_type(formats, "text/plain;charset=utf-8"))
+    format = "text/plain;charset=utf-8";
+  else if (gdk_content_formats_contain_mime_type(formats, "text/plain"))
+    format = "text/plain";
+  if (!format)
+    return;
+
+  clipboard_gtk->prefetch_cancellable = g_cancellable_new();
+  wpe_clipboard_gtk_read_async(clipboard_gtk, format, 0, clipboard_gtk->prefetch_cancellable, NULL, NULL);
 }
 
 static void clipboard_changed_cb(GdkClipboard *clipboard, WPEClipboardGtk *clipboard_gtk)
 {
+  clipboard_gtk->serial++;
+  g_hash_table_remove_all(clipboard_gtk->cache);
+  clipboard_gtk->cache_size = 0;
+
+  // Reads in flight are for the previous contents, new requests start new ones.
+  GHashTableIter iter;
+  ReadOperation *operation;
+  g_hash_table_iter_init(&iter, clipboard_gtk->reads);
+  while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&operation)) {
+    g_cancellable_cancel(operation->cancellable);
+    g_hash_table_iter_remove(&iter);
+  }
+  if (clipboard_gtk->prefetch_cancellable) {
+    g_cancellable_cancel(clipboard_gtk->prefetch_cancellable);
+    g_clear_object(&clipboard_gtk->prefetch_cancellable);
+  }
+
+  GdkContentFormats *formats = gdk_clipboard_get_formats(clipboard_gtk->clipboard);
+  if (clipboard_gtk->prefetch_text && !gdk_clipboard_is_local(clipboard_gtk->clipboard))
+    wpe_clipboard_gtk_prefetch_text(clipboard_gtk, formats);
+
   gsize n_types;
-  const char* const* types = gdk_content_formats_get_mime_types(gdk_clipboard_get_formats(clipboard_gtk->clipboard), &n_types);
+  const char* const* types = gdk_content_formats_get_mime_types(formats, &n_types);
   if (n_types != 0) {
     GPtrArray* formats = g_ptr_array_sized_new(n_types);
     for (unsigned i = 0; types[i]; i++)
@@ -163,3 +427,18 @@ WPEClipboard *wpe_clipboard_gtk_new(GdkDisplay *display)
 
   return WPE_CLIPBOARD(clipboard_gtk);
 }
+
+void wpe_clipboard_gtk_set_prefetch_text(WPEClipboardGtk *clipboard, gboolean prefetch_text)
+{
+  g_return_if_fail(WPE_IS_CLIPBOARD_GTK(clipboard));
+
+  if (clipboard->prefetch_text == prefetch_text)
+    return;
+
+  clipboard->prefetch_text = prefetch_text;
+  if (!prefetch_text && clipboard->prefetch_cancellable) {
+    g_cancellable_cancel(clipboard->prefetch_cancellable);
+    g_clear_object(&clipboard->prefetch_cancellable);
+  }
+  g_object_notify_by_pspec(G_OBJECT(clipboard), properties[PROP_PREFETCH_TEXT]);
+}
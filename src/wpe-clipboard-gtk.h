@@ -30,6 +30,17 @@ G_BEGIN_DECLS
 #define WPE_TYPE_CLIPBOARD_GTK (wpe_clipboard_gtk_get_type())
 G_DECLARE_FINAL_TYPE(WPEClipboardGtk, wpe_clipboard_gtk, WPE, CLIPBOARD_GTK, WPEClipboard)
 
-WPEClipboard *wpe_clipboard_gtk_new (GdkDisplay *display);
+WPEClipboard *wpe_clipboard_gtk_new               (GdkDisplay          *display);
+void          wpe_clipboard_gtk_read_async        (WPEClipboardGtk     *clipboard,
+                                                   const char          *format,
+                                                   gsize                size_hint,
+                                                   GCancellable        *cancellable,
+                                                   GAsyncReadyCallback  callback,
+                                                   gpointer             user_data);
+GBytes       *wpe_clipboard_gtk_read_finish       (WPEClipboardGtk     *clipboard,
+                                                   GAsyncResult        *result,
+                                                   GError             **error);
+void          wpe_clipboard_gtk_set_prefetch_text (WPEClipboardGtk     *clipboard,
+                                                   gboolean             prefetch_text);
 
 G_END_DECLS
@@ -21,15 +21,16 @@
  */
 
 #include "config.h"
-#include "wpe-display-gtk.h"
+#include "wpe-display-gtk-private.h"
 
 #include "wpe-input-method-context-gtk.h"
 #include "wpe-clipboard-gtk.h"
 #include "wpe-keymap-gtk.h"
 #include "wpe-screen-gtk-private.h"
 #include "wpe-toplevel-gtk.h"
-#include "wpe-view-gtk.h"
+#include "wpe-view-gtk-private.h"
 #include <epoxy/egl.h>
+#include <string.h>
 
 #ifdef GDK_WINDOWING_WAYLAND
 #include <gdk/wayland/gdkwayland.h>
@@ -52,6 +53,9 @@ struct _WPEDisplayGtk {
   WPEKeymap *keymap;
   WPEClipboard *clipboard;
   GPtrArray *screens;
+  GHashTable *screens_by_monitor;
+  GPtrArray *views;
+  GMemoryMonitor *memory_monitor;
 
   GSettings *desktop_settings;
 };
@@ -62,7 +66,10 @@ static void wpe_display_gtk_finalize(GObject *object)
 {
   WPEDisplayGtk *display_gtk = WPE_DISPLAY_GTK(object);
   g_clear_pointer(&display_gtk->drm_device, wpe_drm_device_unref);
+  g_clear_pointer(&display_gtk->screens_by_monitor, g_hash_table_unref);
   g_clear_pointer(&display_gtk->screens, g_ptr_array_unref);
+  g_clear_pointer(&display_gtk->views, g_ptr_array_unref);
+  g_clear_object(&display_gtk->memory_monitor);
   g_clear_object(&display_gtk->keymap);
   g_clear_object(&display_gtk->clipboard);
   g_clear_object(&display_gtk->desktop_settings);
@@ -72,12 +79,17 @@ static void wpe_display_gtk_finalize(GObject *object)
 
 static void wpe_display_gtk_monitors_changed(WPEDisplayGtk *display_gtk, guint index, guint n_removed, guint n_added, GListModel *monitors)
 {
-  for (guint i = 0; i < n_removed; i++)
+  for (guint i = 0; i < n_removed; i++) {
+    WPEScreen *screen = g_ptr_array_index(display_gtk->screens, index);
+    g_hash_table_remove(display_gtk->screens_by_monitor, wpe_screen_gtk_get_gdk_monitor(WPE_SCREEN_GTK(screen)));
     g_ptr_array_remove_index(display_gtk->screens, index);
+  }
 
   for (guint i = 0; i < n_added; i++) {
     GdkMonitor *monitor = GDK_MONITOR(g_list_model_get_item(monitors, index + i));
-    g_ptr_array_add(display_gtk->screens, wpe_screen_gtk_create(monitor));
+    WPEScreen *screen = wpe_screen_gtk_create(monitor);
+    g_ptr_array_add(display_gtk->screens, screen);
+    g_hash_table_insert(display_gtk->screens_by_monitor, monitor, screen);
     g_object_unref(monitor);
   }
 }
@@ -87,14 +99,32 @@ static void wpe_display_gtk_setup_screens(WPEDisplayGtk *display_gtk)
   GListModel *monitors = gdk_display_get_monitors(display_gtk->display);
   guint n_monitors = g_list_model_get_n_items(monitors);
   display_gtk->screens = g_ptr_array_new_full(n_monitors, g_object_unref);
+  display_gtk->screens_by_monitor = g_hash_table_new(g_direct_hash, g_direct_equal);
   for (guint i = 0; i < n_monitors; i++) {
     GdkMonitor *monitor = GDK_MONITOR(g_list_model_get_item(monitors, i));
-    g_ptr_array_add(display_gtk->screens, wpe_screen_gtk_create(monitor));
+    WPEScreen *screen = wpe_screen_gtk_create(monitor);
+    g_ptr_array_add(display_gtk->screens, screen);
+    g_hash_table_insert(display_gtk->screens_by_monitor, monitor, screen);
     g_object_unref(monitor);
   }
   g_signal_connect_object(monitors, "items-changed", G_CALLBACK(wpe_display_gtk_monitors_changed), display_gtk, G_CONNECT_SWAPPED);
 }
 
+static void wpe_display_gtk_low_memory_warning(WPEDisplayGtk *display_gtk, GMemoryMonitorWarningLevel level)
+{
+  for (guint i = 0; i < display_gtk->views->len; i++) {
+    WPEDrawingArea *area = wpe_view_gtk_get_drawing_area(WPE_VIEW_GTK(g_ptr_array_index(display_gtk->views, i)));
+    if (area)
+      wpe_drawing_area_trim_memory(area);
+  }
+}
+
+static void wpe_display_gtk_setup_memory_monitor(WPEDisplayGtk *display_gtk)
+{
+  display_gtk->memory_monitor = g_memory_monitor_dup_default();
+  g_signal_connect_object(display_gtk->memory_monitor, "low-memory-warning", G_CALLBACK(wpe_display_gtk_low_memory_warning), display_gtk, G_CONNECT_SWAPPED);
+}
+
 static WPESettingsHintingStyle wpe_font_hinting_style(const char *hinting_style)
 {
   if (g_strcmp0(hinting_style, "hintnone") == 0)
@@ -227,14 +257,12 @@ G_GNUC_BEGIN_IGNORE_DEPRECATIONS
 #endif
 G_GNUC_END_IGNORE_DEPRECATIONS
 
-  if (display_gtk->egl_display == EGL_NO_DISPLAY) {
-    g_set_error_literal(error, WPE_DISPLAY_ERROR, WPE_DISPLAY_ERROR_CONNECTION_FAILED, "Failed to get GTK EGL display");
-    display_gtk->display = NULL;
-    return FALSE;
-  }
-
+  // Without EGL only SHM buffers can be rendered, so there's no DRM device
+  // nor DMA-BUF formats to advertise.
   EGLDeviceEXT egl_device;
-  if (eglQueryDisplayAttribEXT(display_gtk->egl_display, EGL_DEVICE_EXT, (EGLAttrib*)&egl_device)) {
+  if (display_gtk->egl_display == EGL_NO_DISPLAY)
+    g_debug("GTK EGL display not available, only SHM buffers will be supported");
+  else if (eglQueryDisplayAttribEXT(display_gtk->egl_display, EGL_DEVICE_EXT, (EGLAttrib*)&egl_device)) {
     const char *extensions = eglQueryDeviceStringEXT(egl_device, EGL_EXTENSIONS);
     if (epoxy_extension_in_string(extensions, "EGL_EXT_device_drm")) {
       const char* drm_device = eglQueryDeviceStringEXT(egl_device, EGL_DRM_DEVICE_FILE_EXT);
@@ -249,13 +277,20 @@ G_GNUC_END_IGNORE_DEPRECATIONS
   wpe_display_gtk_setup_screens(display_gtk);
   wpe_display_gtk_setup_dark_mode(display_gtk);
   wpe_display_gtk_setup_settings(display_gtk);
+  wpe_display_gtk_setup_memory_monitor(display_gtk);
 
   return TRUE;
 }
 
 static gpointer wpe_display_gtk_get_egl_display(WPEDisplay *display, GError **error)
 {
-  return WPE_DISPLAY_GTK(display)->egl_display;
+  WPEDisplayGtk *display_gtk = WPE_DISPLAY_GTK(display);
+  if (display_gtk->egl_display == EGL_NO_DISPLAY) {
+    g_set_error_literal(error, WPE_DISPLAY_ERROR, WPE_DISPLAY_ERROR_NOT_SUPPORTED, "EGL display not available");
+    return NULL;
+  }
+
+  return display_gtk->egl_display;
 }
 
 static WPEView *wpe_display_gtk_create_view(WPEDisplay *display)
@@ -303,7 +338,7 @@ static WPEClipboard *wpe_display_gtk_get_clipboard(WPEDisplay *display)
 static WPEBufferFormats *wpe_display_gtk_get_preferred_buffer_formats(WPEDisplay *display)
 {
   WPEDisplayGtk *display_gtk = WPE_DISPLAY_GTK(display);
-  if (!display_gtk->display)
+  if (!display_gtk->display || display_gtk->egl_display == EGL_NO_DISPLAY)
     return NULL;
 
   GdkDmabufFormats *formats = gdk_display_get_dmabuf_formats(display_gtk->display);
@@ -378,6 +413,7 @@ static void wpe_display_gtk_class_finalize(WPEDisplayGtkClass *klass)
 static void wpe_display_gtk_init(WPEDisplayGtk *display)
 {
   display->egl_display = EGL_NO_DISPLAY;
+  display->views = g_ptr_array_new();
 }
 
 WPEDisplay *wpe_display_gtk_new(void)
@@ -393,6 +429,16 @@ GdkDisplay *wpe_display_gtk_get_gdk_display(WPEDisplayGtk *display)
   return display->display;
 }
 
+WPEScreen *wpe_display_gtk_get_screen_for_monitor(WPEDisplayGtk *display, GdkMonitor *monitor)
+{
+  g_return_val_if_fail(WPE_IS_DISPLAY_GTK(display), NULL);
+
+  if (!display->screens_by_monitor || !monitor)
+    return NULL;
+
+  return g_hash_table_lookup(display->screens_by_monitor, monitor);
+}
+
 void wpe_display_gtk_register(GIOModule *module)
 {
   wpe_display_gtk_register_type(G_TYPE_MODULE(module));
@@ -400,3 +446,26 @@ void wpe_display_gtk_register(GIOModule *module)
     g_io_extension_point_register(WPE_DISPLAY_EXTENSION_POINT_NAME);
   g_io_extension_point_implement(WPE_DISPLAY_EXTENSION_POINT_NAME, WPE_TYPE_DISPLAY_GTK, "wpe-display-gtk", 200);
 }
+
+void wpe_display_gtk_add_view(WPEDisplayGtk *display, WPEView *view)
+{
+  g_ptr_array_add(display->views, view);
+}
+
+void wpe_display_gtk_remove_view(WPEDisplayGtk *display, WPEView *view)
+{
+  g_ptr_array_remove_fast(display->views, view);
+}
+
+void wpe_display_gtk_get_memory_usage(WPEDisplayGtk *display, WPEMemoryUsageGtk *usage)
+{
+  g_return_if_fail(WPE_IS_DISPLAY_GTK(display));
+  g_return_if_fail(usage);
+
+  memset(usage, 0, sizeof(WPEMemoryUsageGtk));
+  for (guint i = 0; i < display->views->len; i++) {
+    WPEDrawingArea *area = wpe_view_gtk_get_drawing_area(WPE_VIEW_GTK(g_ptr_array_index(display->views, i)));
+    if (area)
+      wpe_drawing_area_add_memory_usage(area, usage);
+  }
+}
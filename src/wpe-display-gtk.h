@@ -33,6 +33,20 @@ G_BEGIN_DECLS
 
 #define WPE_TYPE_DISPLAY_GTK (wpe_display_gtk_get_type())
 
+/* Buffers currently held by the views for drawing. The sizes are the bytes
+ * backing them: DMA-BUF planes imported by GDK and SHM data that GDK uploads.
+ * Callers allocate the struct, so new fields must take the padding.
+ */
+typedef struct {
+  guint n_buffers;
+  guint n_fds;
+  gsize dmabuf_size;
+  gsize shm_size;
+
+  /*< private >*/
+  gpointer padding[8];
+} WPEMemoryUsageGtk;
+
 WPE_PLATFORM_GTK_AVAILABLE_IN_ALL
 G_DECLARE_FINAL_TYPE(WPEDisplayGtk, wpe_display_gtk, WPE, DISPLAY_GTK, WPEDisplay)
 
@@ -40,10 +54,14 @@ WPE_PLATFORM_GTK_AVAILABLE_IN_ALL
 void wpe_display_gtk_register(GIOModule *module);
 
 WPE_PLATFORM_GTK_AVAILABLE_IN_ALL
-WPEDisplay *wpe_display_gtk_new             (void);
+WPEDisplay *wpe_display_gtk_new              (void);
+
+WPE_PLATFORM_GTK_AVAILABLE_IN_ALL
+GdkDisplay *wpe_display_gtk_get_gdk_display  (WPEDisplayGtk     *display);
 
 WPE_PLATFORM_GTK_AVAILABLE_IN_ALL
-GdkDisplay *wpe_display_gtk_get_gdk_display (WPEDisplayGtk *display);
+void        wpe_display_gtk_get_memory_usage (WPEDisplayGtk     *display,
+                                              WPEMemoryUsageGtk *usage);
 
 G_END_DECLS
 
@@ -25,6 +25,9 @@
 #include "wpe-display-gtk.h"
 #include "wpe-toplevel-gtk.h"
 
+#include <string.h>
+#include <sys/stat.h>
+
 #ifdef GTK_ACCESSIBILITY_ATSPI
 #include <gtk/a11y/gtkatspi.h>
 #endif
@@ -39,11 +42,22 @@ enum {
 
 static GParamSpec *properties[N_PROPS];
 
+#define RESIZE_INTERVAL_USEC (50 * 1000)
+#define CAIRO_TILE_SIZE 256
+
 typedef struct {
   double x;
   double y;
 } MotionEvent;
 
+typedef struct {
+  GPtrArray *nodes;
+  int width;
+  int height;
+  double scale;
+  cairo_region_t *damage;
+} CairoTiles;
+
 struct _WPEDrawingArea {
   GtkWidget parent;
 
@@ -52,11 +66,22 @@ struct _WPEDrawingArea {
   WPEBuffer *committed_buffer;
 
   MotionEvent last_motion_event;
+  gboolean input_method_enabled;
+
+  int width;
+  int height;
+  gint64 last_resize_time;
+  guint resize_tick_id;
 
   GtkWidget *context_menu;
 
+  cairo_region_t *pending_damage;
+  CairoTiles cairo_tiles;
+
 #ifdef GTK_ACCESSIBILITY_ATSPI
   GtkAccessible *accessible;
+  char *plug_id;
+  gboolean watching_accessibility_status;
 #endif
 };
 
@@ -73,6 +98,7 @@ G_DEFINE_FINAL_TYPE(WPEDrawingArea, wpe_drawing_area, GTK_TYPE_WIDGET)
 
 typedef struct {
   GdkDmabufTextureBuilder *builder;
+  GdkMemoryTextureBuilder *memory_builder;
   GdkTexture *texture;
 } WPEBufferGtk;
 
@@ -102,8 +128,19 @@ static WPEBufferGtk *wpe_buffer_gtk_create(WPEBuffer *buffer)
     return buffer_gtk;
   }
 
-  if (WPE_IS_BUFFER_SHM(buffer))
+  if (WPE_IS_BUFFER_SHM(buffer)) {
+    WPEBufferSHM *buffer_shm = WPE_BUFFER_SHM(buffer);
+
+    GdkMemoryTextureBuilder *builder = gdk_memory_texture_builder_new();
+    gdk_memory_texture_builder_set_width(builder, wpe_buffer_get_width(buffer));
+    gdk_memory_texture_builder_set_height(builder, wpe_buffer_get_height(buffer));
+    gdk_memory_texture_builder_set_format(builder, GDK_MEMORY_DEFAULT);
+    gdk_memory_texture_builder_set_bytes(builder, wpe_buffer_shm_get_data(buffer_shm));
+    gdk_memory_texture_builder_set_stride(builder, wpe_buffer_shm_get_stride(buffer_shm));
+
+    buffer_gtk->memory_builder = builder;
     return buffer_gtk;
+  }
 
   g_free(buffer_gtk);
   return NULL;
@@ -112,11 +149,30 @@ static WPEBufferGtk *wpe_buffer_gtk_create(WPEBuffer *buffer)
 static void wpe_buffer_gtk_free(WPEBufferGtk *buffer_gtk)
 {
   g_clear_object(&buffer_gtk->builder);
+  g_clear_object(&buffer_gtk->memory_builder);
   g_clear_object(&buffer_gtk->texture);
 
   g_free(buffer_gtk);
 }
 
+static void cairo_tiles_clear(CairoTiles *tiles)
+{
+  g_clear_pointer(&tiles->nodes, g_ptr_array_unref);
+  g_clear_pointer(&tiles->damage, cairo_region_destroy);
+}
+
+static void cairo_tiles_add_damage(CairoTiles *tiles, const cairo_region_t *damage)
+{
+  // A NULL damage region means every tile is out of date.
+  if (!tiles->damage)
+    return;
+
+  if (damage)
+    cairo_region_union(tiles->damage, damage);
+  else
+    g_clear_pointer(&tiles->damage, cairo_region_destroy);
+}
+
 static void wpe_drawing_area_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
 {
   WPEDrawingArea *area = WPE_DRAWING_AREA(object);
@@ -138,20 +194,142 @@ static void wpe_drawing_area_dispose(GObject *object)
   g_clear_object(&area->pending_buffer);
   g_clear_object(&area->committed_buffer);
   g_clear_pointer(&area->context_menu, gtk_widget_unparent);
+  g_clear_pointer(&area->pending_damage, cairo_region_destroy);
+  cairo_tiles_clear(&area->cairo_tiles);
 
 #ifdef GTK_ACCESSIBILITY_ATSPI
   g_clear_object(&area->accessible);
+  g_clear_pointer(&area->plug_id, g_free);
 #endif
 
   G_OBJECT_CLASS(wpe_drawing_area_parent_class)->dispose(object);
 }
 
+static void wpe_drawing_area_notify_resized(WPEDrawingArea *area)
+{
+  if (area->resize_tick_id) {
+    gtk_widget_remove_tick_callback(GTK_WIDGET(area), area->resize_tick_id);
+    area->resize_tick_id = 0;
+  }
+
+  area->last_resize_time = g_get_monotonic_time();
+  if (wpe_view_get_width(area->view) != area->width || wpe_view_get_height(area->view) != area->height)
+    wpe_view_resized(area->view, area->width, area->height);
+}
+
+static gboolean wpe_drawing_area_resize_tick(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data)
+{
+  WPEDrawingArea *area = WPE_DRAWING_AREA(widget);
+  if (gdk_frame_clock_get_frame_time(frame_clock) - area->last_resize_time < RESIZE_INTERVAL_USEC)
+    return G_SOURCE_CONTINUE;
+
+  area->resize_tick_id = 0;
+  wpe_drawing_area_notify_resized(area);
+  return G_SOURCE_REMOVE;
+}
+
 static void wpe_drawing_area_size_allocate(GtkWidget *widget, int width, int height, int baseline)
 {
   GTK_WIDGET_CLASS(wpe_drawing_area_parent_class)->size_allocate(widget, width, height, baseline);
 
   WPEDrawingArea *area = WPE_DRAWING_AREA(widget);
-  wpe_view_resized(area->view, width, height);
+  area->width = width;
+  area->height = height;
+
+  // Rate limit resizes to avoid a relayout and new buffers on every allocation
+  // during interactive resizing; the last frame is shown until then.
+  if (!gtk_widget_get_mapped(widget) || g_get_monotonic_time() - area->last_resize_time >= RESIZE_INTERVAL_USEC) {
+    wpe_drawing_area_notify_resized(area);
+    return;
+  }
+
+  if (!area->resize_tick_id)
+    area->resize_tick_id = gtk_widget_add_tick_callback(widget, wpe_drawing_area_resize_tick, NULL, NULL);
+}
+
+static void wpe_drawing_area_commit_damage(WPEDrawingArea *area)
+{
+  cairo_region_t *damage = g_steal_pointer(&area->pending_damage);
+  area->pending_damage = cairo_region_create();
+
+  cairo_tiles_add_damage(&area->cairo_tiles, damage);
+
+  if (damage)
+    cairo_region_destroy(damage);
+}
+
+static gboolean wpe_drawing_area_can_use_cairo_tiles(WPEDrawingArea *area)
+{
+  // SHM buffers are premultiplied BGRA, that is CAIRO_FORMAT_ARGB32 only on little endian.
+  if (G_BYTE_ORDER != G_LITTLE_ENDIAN || !WPE_IS_BUFFER_SHM(area->committed_buffer))
+    return FALSE;
+
+  GtkNative *native = gtk_widget_get_native(GTK_WIDGET(area));
+  GskRenderer *renderer = native ? gtk_native_get_renderer(native) : NULL;
+  return renderer && GSK_IS_CAIRO_RENDERER(renderer);
+}
+
+static GskRenderNode *wpe_buffer_shm_create_tile_node(WPEBufferSHM *buffer, const cairo_rectangle_int_t *tile, double scale)
+{
+  cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, tile->width, tile->height);
+  const guchar *src = g_bytes_get_data(wpe_buffer_shm_get_data(buffer), NULL);
+  guint src_stride = wpe_buffer_shm_get_stride(buffer);
+  guchar *dst = cairo_image_surface_get_data(surface);
+  int dst_stride = cairo_image_surface_get_stride(surface);
+  for (int y = 0; y < tile->height; y++)
+    memcpy(dst + y * dst_stride, src + (tile->y + y) * src_stride + tile->x * 4, tile->width * 4);
+  cairo_surface_mark_dirty(surface);
+
+  GskRenderNode *node = gsk_cairo_node_new(&GRAPHENE_RECT_INIT(tile->x / scale, tile->y / scale, tile->width / scale, tile->height / scale));
+  cairo_t *cr = gsk_cairo_node_get_draw_context(node);
+  cairo_scale(cr, 1. / scale, 1. / scale);
+  cairo_set_source_surface(cr, surface, tile->x, tile->y);
+  cairo_paint(cr);
+  cairo_destroy(cr);
+  cairo_surface_destroy(surface);
+
+  return node;
+}
+
+static void wpe_drawing_area_update_cairo_tiles(WPEDrawingArea *area, double scale)
+{
+  CairoTiles *tiles = &area->cairo_tiles;
+  int width = wpe_buffer_get_width(area->committed_buffer);
+  int height = wpe_buffer_get_height(area->committed_buffer);
+  if (tiles->nodes && (tiles->width != width || tiles->height != height || tiles->scale != scale))
+    cairo_tiles_clear(tiles);
+
+  int n_columns = (width + CAIRO_TILE_SIZE - 1) / CAIRO_TILE_SIZE;
+  int n_rows = (height + CAIRO_TILE_SIZE - 1) / CAIRO_TILE_SIZE;
+  if (!tiles->nodes) {
+    tiles->nodes = g_ptr_array_new_full(n_columns * n_rows, (GDestroyNotify)gsk_render_node_unref);
+    tiles->width = width;
+    tiles->height = height;
+    tiles->scale = scale;
+    g_clear_pointer(&tiles->damage, cairo_region_destroy);
+  }
+
+  // Only the damaged tiles get a new node, the others keep the node of the
+  // previous frame so that the render node diff skips them.
+  for (int row = 0; row < n_rows; row++) {
+    for (int column = 0; column < n_columns; column++) {
+      guint index = row * n_columns + column;
+      cairo_rectangle_int_t tile = {
+        column * CAIRO_TILE_SIZE, row * CAIRO_TILE_SIZE,
+        MIN(CAIRO_TILE_SIZE, width - column * CAIRO_TILE_SIZE), MIN(CAIRO_TILE_SIZE, height - row * CAIRO_TILE_SIZE)
+      };
+      if (index < tiles->nodes->len) {
+        if (tiles->damage && cairo_region_contains_rectangle(tiles->damage, &tile) == CAIRO_REGION_OVERLAP_OUT)
+          continue;
+        gsk_render_node_unref(g_ptr_array_index(tiles->nodes, index));
+        g_ptr_array_index(tiles->nodes, index) = wpe_buffer_shm_create_tile_node(WPE_BUFFER_SHM(area->committed_buffer), &tile, scale);
+      } else
+        g_ptr_array_add(tiles->nodes, wpe_buffer_shm_create_tile_node(WPE_BUFFER_SHM(area->committed_buffer), &tile, scale));
+    }
+  }
+
+  g_clear_pointer(&tiles->damage, cairo_region_destroy);
+  tiles->damage = cairo_region_create();
 }
 
 static void wpe_drawing_area_snapshot(GtkWidget *widget, GtkSnapshot *snapshot)
@@ -166,17 +344,34 @@ static void wpe_drawing_area_snapshot(GtkWidget *widget, GtkSnapshot *snapshot)
       g_object_unref(area->committed_buffer);
     }
     area->committed_buffer = g_steal_pointer(&area->pending_buffer);
+    wpe_drawing_area_commit_damage(area);
   }
 
   if (!area->committed_buffer)
     return;
 
-  WPEBufferGtk *buffer_gtk = wpe_buffer_get_user_data(area->committed_buffer);
-  if (buffer_gtk && buffer_gtk->texture) {
-    graphene_rect_t rect = GRAPHENE_RECT_INIT(0, 0, wpe_view_get_width(area->view), wpe_view_get_height(area->view));
-    gtk_snapshot_append_texture(snapshot, buffer_gtk->texture, &rect);
+  // Draw the buffer at its own size, so that a frame of the previous size
+  // stays anchored instead of stretched while a resize is in flight, but
+  // clipped so that a larger one doesn't paint outside the widget.
+  double scale = wpe_view_get_scale(area->view);
+  graphene_rect_t rect = GRAPHENE_RECT_INIT(0, 0, wpe_buffer_get_width(area->committed_buffer) / scale, wpe_buffer_get_height(area->committed_buffer) / scale);
+  gtk_snapshot_push_clip(snapshot, &GRAPHENE_RECT_INIT(0, 0, gtk_widget_get_width(widget), gtk_widget_get_height(widget)));
+
+  if (wpe_drawing_area_can_use_cairo_tiles(area)) {
+    // With the cairo renderer, the frame is drawn as a grid of cairo nodes.
+    // Only damaged tiles are copied from the SHM buffer, and since cairo nodes
+    // can't be diffed, unchanged tiles reuse their node to limit the repaint.
+    wpe_drawing_area_update_cairo_tiles(area, scale);
+    for (guint i = 0; i < area->cairo_tiles.nodes->len; i++)
+      gtk_snapshot_append_node(snapshot, g_ptr_array_index(area->cairo_tiles.nodes, i));
+  } else {
+    WPEBufferGtk *buffer_gtk = wpe_buffer_get_user_data(area->committed_buffer);
+    if (buffer_gtk && buffer_gtk->texture)
+      gtk_snapshot_append_texture(snapshot, buffer_gtk->texture, &rect);
   }
 
+  gtk_snapshot_pop(snapshot);
+
   if (notify_buffer_rendered)
     wpe_view_buffer_rendered(area->view, area->committed_buffer);
 }
@@ -200,9 +395,12 @@ static void wpe_drawing_area_map(GtkWidget *widget)
 
 static void wpe_drawing_area_unmap(GtkWidget *widget)
 {
+  WPEDrawingArea *area = WPE_DRAWING_AREA(widget);
+  if (area->resize_tick_id)
+    wpe_drawing_area_notify_resized(area);
+
   GTK_WIDGET_CLASS(wpe_drawing_area_parent_class)->unmap(widget);
 
-  WPEDrawingArea *area = WPE_DRAWING_AREA(widget);
   wpe_view_unmap(area->view);
 }
 
@@ -447,7 +645,8 @@ static gboolean wpe_drawing_area_key_pressed(WPEDrawingArea *area, guint keyval,
                            gdk_event_get_time(gdk_event),
                            wpe_modifiers_for_gdk_modifiers(gdk_event_get_modifier_state(gdk_event)),
                            keycode, keyval);
-  wpe_event_set_user_data(event, gdk_event_ref(gdk_event), (GDestroyNotify)gdk_event_unref);
+  if (area->input_method_enabled)
+    wpe_event_set_user_data(event, gdk_event_ref(gdk_event), (GDestroyNotify)gdk_event_unref);
   wpe_view_event(area->view, event);
   return GDK_EVENT_STOP;
 }
@@ -462,7 +661,8 @@ static gboolean wpe_drawing_area_key_released(WPEDrawingArea *area, guint keyval
                            gdk_event_get_time(gdk_event),
                            wpe_modifiers_for_gdk_modifiers(gdk_event_get_modifier_state(gdk_event)),
                            keycode, keyval);
-  wpe_event_set_user_data(event, gdk_event_ref(gdk_event), (GDestroyNotify)gdk_event_unref);
+  if (area->input_method_enabled)
+    wpe_event_set_user_data(event, gdk_event_ref(gdk_event), (GDestroyNotify)gdk_event_unref);
   wpe_view_event(area->view, event);
   return GDK_EVENT_STOP;
 }
@@ -513,24 +713,44 @@ GtkWidget *wpe_drawing_area_new(WPEView *view)
   return g_object_new(WPE_TYPE_DRAWING_AREA, "view", view, NULL);
 }
 
-static void wpe_drawing_area_update_buffer_damage(WPEDrawingArea *area, WPEBufferGtk *buffer_gtk, const WPERectangle *damage_rects, guint n_damage_rects)
+static void wpe_buffer_gtk_set_update(WPEBufferGtk *buffer_gtk, GdkTexture *update_texture, cairo_region_t *update_region)
 {
-  if (n_damage_rects > 0 && area->committed_buffer) {
-    WPEBufferGtk *committed_buffer_gtk = wpe_buffer_get_user_data(area->committed_buffer);
-    gdk_dmabuf_texture_builder_set_update_texture(buffer_gtk->builder, committed_buffer_gtk->texture);
-    cairo_region_t *region = cairo_region_create();
-    for (guint i = 0; i < n_damage_rects; i++) {
-      cairo_rectangle_int_t rect = { damage_rects[i].x, damage_rects[i].y, damage_rects[i].width, damage_rects[i].height };
-      cairo_region_union_rectangle(region, &rect);
-    }
-    gdk_dmabuf_texture_builder_set_update_region(buffer_gtk->builder, region);
-    cairo_region_destroy(region);
+  if (buffer_gtk->builder) {
+    gdk_dmabuf_texture_builder_set_update_texture(buffer_gtk->builder, update_texture);
+    gdk_dmabuf_texture_builder_set_update_region(buffer_gtk->builder, update_region);
   } else {
-    gdk_dmabuf_texture_builder_set_update_texture(buffer_gtk->builder, NULL);
-    gdk_dmabuf_texture_builder_set_update_region(buffer_gtk->builder, NULL);
+    gdk_memory_texture_builder_set_update_texture(buffer_gtk->memory_builder, update_texture);
+    gdk_memory_texture_builder_set_update_region(buffer_gtk->memory_builder, update_region);
   }
 }
 
+static void wpe_drawing_area_update_buffer_damage(WPEDrawingArea *area, WPEBuffer *buffer, WPEBufferGtk *buffer_gtk, const WPERectangle *damage_rects, guint n_damage_rects)
+{
+  // Damage is relative to the last buffer submitted, which may not have been committed yet.
+  WPEBuffer *previous_buffer = area->pending_buffer ? area->pending_buffer : area->committed_buffer;
+  if (!n_damage_rects || !previous_buffer || previous_buffer == buffer) {
+    wpe_buffer_gtk_set_update(buffer_gtk, NULL, NULL);
+    return;
+  }
+
+  WPEBufferGtk *previous_buffer_gtk = wpe_buffer_get_user_data(previous_buffer);
+  GdkTexture *previous_texture = previous_buffer_gtk ? previous_buffer_gtk->texture : NULL;
+  if (!previous_texture
+      || gdk_texture_get_width(previous_texture) != wpe_buffer_get_width(buffer)
+      || gdk_texture_get_height(previous_texture) != wpe_buffer_get_height(buffer)) {
+    wpe_buffer_gtk_set_update(buffer_gtk, NULL, NULL);
+    return;
+  }
+
+  cairo_region_t *region = cairo_region_create();
+  for (guint i = 0; i < n_damage_rects; i++) {
+    cairo_rectangle_int_t rect = { damage_rects[i].x, damage_rects[i].y, damage_rects[i].width, damage_rects[i].height };
+    cairo_region_union_rectangle(region, &rect);
+  }
+  wpe_buffer_gtk_set_update(buffer_gtk, previous_texture, region);
+  cairo_region_destroy(region);
+}
+
 static gboolean wpe_drawing_area_ensure_texture(WPEDrawingArea *area, WPEBuffer *buffer, const WPERectangle *damage_rects, guint n_damage_rects, GError **error)
 {
   WPEBufferGtk* buffer_gtk = wpe_buffer_get_user_data(buffer);
@@ -545,21 +765,23 @@ static gboolean wpe_drawing_area_ensure_texture(WPEDrawingArea *area, WPEBuffer
 
   g_clear_object(&buffer_gtk->texture);
 
-  if (buffer_gtk->builder) {
-    wpe_drawing_area_update_buffer_damage(area, buffer_gtk, damage_rects, n_damage_rects);
+  wpe_drawing_area_update_buffer_damage(area, buffer, buffer_gtk, damage_rects, n_damage_rects);
 
-    g_autoptr(GError) buffer_error = NULL;
+  g_autoptr(GError) buffer_error = NULL;
+  if (buffer_gtk->builder)
     buffer_gtk->texture = gdk_dmabuf_texture_builder_build(buffer_gtk->builder, NULL, NULL, &buffer_error);
-    if (!buffer_gtk->texture) {
+  else
+    buffer_gtk->texture = gdk_memory_texture_builder_build(buffer_gtk->memory_builder);
+
+  // The builder outlives the frame, don't keep the previous texture alive.
+  wpe_buffer_gtk_set_update(buffer_gtk, NULL, NULL);
+
+  if (!buffer_gtk->texture) {
+    if (buffer_error)
       g_set_error(error, WPE_VIEW_ERROR, WPE_VIEW_ERROR_RENDER_FAILED, "Failed to render buffer: failed to build DMA-BUF texture: %s", buffer_error->message);
-      return FALSE;
-    }
-  } else {
-    buffer_gtk->texture = gdk_memory_texture_new(wpe_buffer_get_width(buffer),
-                                                 wpe_buffer_get_height(buffer),
-                                                 GDK_MEMORY_DEFAULT,
-                                                 wpe_buffer_shm_get_data(WPE_BUFFER_SHM(buffer)),
-                                                 wpe_buffer_shm_get_stride(WPE_BUFFER_SHM(buffer)));
+    else
+      g_set_error_literal(error, WPE_VIEW_ERROR, WPE_VIEW_ERROR_RENDER_FAILED, "Failed to render buffer: failed to build texture");
+    return FALSE;
   }
 
   return TRUE;
@@ -572,11 +794,104 @@ gboolean wpe_drawing_area_render_buffer(WPEDrawingArea *area, WPEBuffer *buffer,
   if (!wpe_drawing_area_ensure_texture(area, buffer, damage_rects, n_damage_rects, error))
     return FALSE;
 
+  if (area->pending_damage) {
+    if (n_damage_rects) {
+      for (guint i = 0; i < n_damage_rects; i++) {
+        cairo_rectangle_int_t rect = { damage_rects[i].x, damage_rects[i].y, damage_rects[i].width, damage_rects[i].height };
+        cairo_region_union_rectangle(area->pending_damage, &rect);
+      }
+    } else
+      g_clear_pointer(&area->pending_damage, cairo_region_destroy);
+  }
+
+  if (area->pending_buffer && area->pending_buffer != buffer)
+    wpe_view_buffer_released(area->view, area->pending_buffer);
+
   g_set_object(&area->pending_buffer, buffer);
   gtk_widget_queue_draw(GTK_WIDGET(area));
   return TRUE;
 }
 
+static void wpe_buffer_add_memory_usage(WPEBuffer *buffer, WPEMemoryUsageGtk *usage)
+{
+  usage->n_buffers++;
+
+  if (WPE_IS_BUFFER_DMA_BUF(buffer)) {
+    WPEBufferDMABuf *buffer_dmabuf = WPE_BUFFER_DMA_BUF(buffer);
+    guint32 n_planes = wpe_buffer_dma_buf_get_n_planes(buffer_dmabuf);
+    for (guint32 i = 0; i < n_planes; i++) {
+      int fd = wpe_buffer_dma_buf_get_fd(buffer_dmabuf, i);
+      gboolean is_new_fd = TRUE;
+      for (guint32 j = 0; j < i && is_new_fd; j++)
+        is_new_fd = wpe_buffer_dma_buf_get_fd(buffer_dmabuf, j) != fd;
+      if (!is_new_fd)
+        continue;
+
+      // The fd belongs to the buffer, so use fstat() rather than lseek() to
+      // leave its offset alone. DMA-BUF inodes report the buffer size.
+      struct stat fd_stat;
+      if (!fstat(fd, &fd_stat) && fd_stat.st_size > 0)
+        usage->dmabuf_size += fd_stat.st_size;
+      usage->n_fds++;
+    }
+  } else if (WPE_IS_BUFFER_SHM(buffer))
+    usage->shm_size += g_bytes_get_size(wpe_buffer_shm_get_data(WPE_BUFFER_SHM(buffer)));
+}
+
+void wpe_drawing_area_add_memory_usage(WPEDrawingArea *area, WPEMemoryUsageGtk *usage)
+{
+  g_return_if_fail(WPE_IS_DRAWING_AREA(area));
+  g_return_if_fail(usage);
+
+  if (area->pending_buffer)
+    wpe_buffer_add_memory_usage(area->pending_buffer, usage);
+  if (area->committed_buffer && area->committed_buffer != area->pending_buffer)
+    wpe_buffer_add_memory_usage(area->committed_buffer, usage);
+}
+
+static void wpe_drawing_area_release_buffer(WPEDrawingArea *area, WPEBuffer *buffer)
+{
+  // Drop the texture and builder now, the buffer may stay alive in WebKit's swapchain.
+  wpe_buffer_set_user_data(buffer, NULL, NULL);
+  wpe_view_buffer_released(area->view, buffer);
+  g_object_unref(buffer);
+}
+
+void wpe_drawing_area_trim_memory(WPEDrawingArea *area)
+{
+  g_return_if_fail(WPE_IS_DRAWING_AREA(area));
+
+  if (gtk_widget_get_mapped(GTK_WIDGET(area)))
+    return;
+
+  // Nothing is drawn while unmapped, so the pending buffer is reported as
+  // rendered before giving it back, or WebKit would keep waiting for it.
+  WPEBuffer *pending_buffer = g_steal_pointer(&area->pending_buffer);
+  if (pending_buffer) {
+    wpe_view_buffer_rendered(area->view, pending_buffer);
+    if (pending_buffer == area->committed_buffer)
+      g_object_unref(pending_buffer);
+    else
+      wpe_drawing_area_release_buffer(area, pending_buffer);
+  }
+
+  // WebKit resumes painting when the view is mapped again, the next frame
+  // replaces the released one.
+  WPEBuffer *committed_buffer = g_steal_pointer(&area->committed_buffer);
+  if (committed_buffer)
+    wpe_drawing_area_release_buffer(area, committed_buffer);
+
+  g_clear_pointer(&area->pending_damage, cairo_region_destroy);
+  cairo_tiles_clear(&area->cairo_tiles);
+}
+
+void wpe_drawing_area_set_input_method_enabled(WPEDrawingArea *area, gboolean enabled)
+{
+  g_return_if_fail(WPE_IS_DRAWING_AREA(area));
+
+  area->input_method_enabled = enabled;
+}
+
 void wpe_drawing_area_show_context_menu(WPEDrawingArea *area, GMenuModel *menu, GActionGroup *group, GdkRectangle *rect)
 {
   g_return_if_fail(WPE_IS_DRAWING_AREA(area));
@@ -616,17 +931,28 @@ static void wpe_drawing_area_accessible_interface_init(GtkAccessibleInterface* i
   iface->get_first_accessible_child = wpe_drawing_area_get_first_accessible_child;
 }
 
-static void wpe_drawing_area_bind(WPEViewAccessible *accessible, const char *plugID)
+static GDBusProxy *accessibility_status_proxy;
+static GPtrArray *accessibility_status_pending_areas;
+
+static gboolean wpe_drawing_area_accessibility_is_active(void)
 {
-  WPEDrawingArea *area = WPE_DRAWING_AREA(accessible);
+  if (!accessibility_status_proxy)
+    return FALSE;
 
-  if (area->accessible) {
-    gtk_accessible_set_accessible_parent(area->accessible, NULL, NULL);
-    g_clear_object(&area->accessible);
+  static const char *properties[] = { "ScreenReaderEnabled", "IsEnabled" };
+  for (guint i = 0; i < G_N_ELEMENTS(properties); i++) {
+    g_autoptr(GVariant) value = g_dbus_proxy_get_cached_property(accessibility_status_proxy, properties[i]);
+    if (value && g_variant_is_of_type(value, G_VARIANT_TYPE_BOOLEAN) && g_variant_get_boolean(value))
+      return TRUE;
   }
 
+  return FALSE;
+}
+
+static void wpe_drawing_area_create_accessible(WPEDrawingArea *area)
+{
   GError *error = NULL;
-  char **tokens = g_strsplit(plugID, ":", 2);
+  char **tokens = g_strsplit(area->plug_id, ":", 2);
   if (!g_dbus_is_unique_name(tokens[0])) {
     area->accessible = gtk_at_spi_socket_new(tokens[0], tokens[1], &error);
   } else {
@@ -647,6 +973,93 @@ static void wpe_drawing_area_bind(WPEViewAccessible *accessible, const char *plu
   gtk_accessible_set_accessible_parent(area->accessible, GTK_ACCESSIBLE(area), GTK_ACCESSIBLE(child));
 }
 
+static void wpe_drawing_area_destroy_accessible(WPEDrawingArea *area)
+{
+  if (!area->accessible)
+    return;
+
+  gtk_accessible_set_accessible_parent(area->accessible, NULL, NULL);
+  g_clear_object(&area->accessible);
+}
+
+static void wpe_drawing_area_update_accessible(WPEDrawingArea *area)
+{
+  if (area->plug_id && wpe_drawing_area_accessibility_is_active()) {
+    if (!area->accessible)
+      wpe_drawing_area_create_accessible(area);
+  } else
+    wpe_drawing_area_destroy_accessible(area);
+}
+
+static void wpe_drawing_area_accessibility_status_changed(WPEDrawingArea *area, GVariant *changed_properties, GStrv invalidated_properties, GDBusProxy *proxy)
+{
+  wpe_drawing_area_update_accessible(area);
+}
+
+static void wpe_drawing_area_accessibility_bus_owner_changed(WPEDrawingArea *area, GParamSpec *pspec, GDBusProxy *proxy)
+{
+  wpe_drawing_area_update_accessible(area);
+}
+
+static void wpe_drawing_area_connect_accessibility_status(WPEDrawingArea *area)
+{
+  // When the bus appears later the proxy loads the properties without emitting
+  // g-properties-changed, so check them again when the name owner changes.
+  g_signal_connect_object(accessibility_status_proxy, "g-properties-changed", G_CALLBACK(wpe_drawing_area_accessibility_status_changed), area, G_CONNECT_SWAPPED);
+  g_signal_connect_object(accessibility_status_proxy, "notify::g-name-owner", G_CALLBACK(wpe_drawing_area_accessibility_bus_owner_changed), area, G_CONNECT_SWAPPED);
+  wpe_drawing_area_update_accessible(area);
+}
+
+static void accessibility_status_proxy_ready_cb(GObject *object, GAsyncResult *result, gpointer user_data)
+{
+  g_autoptr(GPtrArray) areas = g_steal_pointer(&accessibility_status_pending_areas);
+
+  g_autoptr(GError) error = NULL;
+  accessibility_status_proxy = g_dbus_proxy_new_for_bus_finish(result, &error);
+  if (!accessibility_status_proxy) {
+    g_debug("Failed to connect to accessibility bus status: %s", error->message);
+    for (guint i = 0; i < areas->len; i++)
+      WPE_DRAWING_AREA(g_ptr_array_index(areas, i))->watching_accessibility_status = FALSE;
+    return;
+  }
+
+  for (guint i = 0; i < areas->len; i++)
+    wpe_drawing_area_connect_accessibility_status(WPE_DRAWING_AREA(g_ptr_array_index(areas, i)));
+}
+
+static void wpe_drawing_area_watch_accessibility_status(WPEDrawingArea *area)
+{
+  area->watching_accessibility_status = TRUE;
+  if (accessibility_status_proxy) {
+    wpe_drawing_area_connect_accessibility_status(area);
+    return;
+  }
+
+  if (!accessibility_status_pending_areas) {
+    accessibility_status_pending_areas = g_ptr_array_new_with_free_func(g_object_unref);
+    g_dbus_proxy_new_for_bus(G_BUS_TYPE_SESSION, G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START, NULL,
+                             "org.a11y.Bus", "/org/a11y/bus", "org.a11y.Status",
+                             NULL, accessibility_status_proxy_ready_cb, NULL);
+  }
+  g_ptr_array_add(accessibility_status_pending_areas, g_object_ref(area));
+}
+
+static void wpe_drawing_area_bind(WPEViewAccessible *accessible, const char *plugID)
+{
+  WPEDrawingArea *area = WPE_DRAWING_AREA(accessible);
+
+  // The socket is only created while an assistive technology is active,
+  // to avoid the setup cost and D-Bus traffic when nobody is listening.
+  wpe_drawing_area_destroy_accessible(area);
+  g_free(area->plug_id);
+  area->plug_id = g_strdup(plugID);
+
+  if (area->watching_accessibility_status)
+    wpe_drawing_area_update_accessible(area);
+  else
+    wpe_drawing_area_watch_accessibility_status(area);
+}
+
 static void wpe_drawing_area_view_accessible_interface_init(WPEViewAccessibleInterface* iface)
 {
   iface->bind = wpe_drawing_area_bind;
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "wpe-display-gtk.h"
 #include <gtk/gtk.h>
 #include <wpe/wpe-platform.h>
 
@@ -30,15 +31,20 @@ G_BEGIN_DECLS
 #define WPE_TYPE_DRAWING_AREA (wpe_drawing_area_get_type())
 G_DECLARE_FINAL_TYPE(WPEDrawingArea, wpe_drawing_area, WPE, DRAWING_AREA, GtkWidget)
 
-GtkWidget *wpe_drawing_area_new               (WPEView            *view);
-gboolean   wpe_drawing_area_render_buffer     (WPEDrawingArea     *area,
-                                               WPEBuffer          *buffer,
-                                               const WPERectangle *damage_rects,
-                                               guint               n_damage_rects,
-                                               GError            **error);
-void       wpe_drawing_area_show_context_menu (WPEDrawingArea     *area,
-                                               GMenuModel         *menu,
-                                               GActionGroup       *group,
-                                               GdkRectangle       *rect);
+GtkWidget *wpe_drawing_area_new                       (WPEView            *view);
+gboolean   wpe_drawing_area_render_buffer             (WPEDrawingArea     *area,
+                                                       WPEBuffer          *buffer,
+                                                       const WPERectangle *damage_rects,
+                                                       guint               n_damage_rects,
+                                                       GError            **error);
+void       wpe_drawing_area_show_context_menu         (WPEDrawingArea     *area,
+                                                       GMenuModel         *menu,
+                                                       GActionGroup       *group,
+                                                       GdkRectangle       *rect);
+void       wpe_drawing_area_set_input_method_enabled  (WPEDrawingArea     *area,
+                                                       gboolean            enabled);
+void       wpe_drawing_area_add_memory_usage          (WPEDrawingArea     *area,
+                                                       WPEMemoryUsageGtk  *usage);
+void       wpe_drawing_area_trim_memory               (WPEDrawingArea     *area);
 
 G_END_DECLS
@@ -22,24 +22,48 @@
 
 #include "wpe-input-method-context-gtk.h"
 
-#include "wpe-view-gtk.h"
+#include "wpe-view-gtk-private.h"
 #include <gtk/gtk.h>
+#include <string.h>
+
+#define SURROUNDING_TEXT_CONTEXT_LENGTH 1024
+
+typedef enum {
+  PENDING_STATE_CURSOR_AREA = 1 << 0,
+  PENDING_STATE_PURPOSE = 1 << 1,
+  PENDING_STATE_HINTS = 1 << 2
+} PendingState;
 
 struct _WPEInputMethodContextGtk {
   WPEInputMethodContext parent;
 
   GtkIMContext *im_context;
+  gboolean focused;
   gchar *surrounding_text;
+  gsize surrounding_length;
   guint surrounding_cursor_index;
   guint surrounding_selection_index;
+
+  PendingState pending_state;
+  guint flush_id;
+  GdkRectangle cursor_area;
+  gboolean cursor_area_applied;
+  GdkRectangle applied_cursor_area;
+  GtkInputPurpose applied_purpose;
+  GtkInputHints applied_hints;
+
+  gboolean preedit_valid;
+  gchar *preedit_text;
+  GList *preedit_underlines;
+  guint preedit_cursor_offset;
 };
 
 G_DEFINE_FINAL_TYPE(WPEInputMethodContextGtk, wpe_input_method_context_gtk, WPE_TYPE_INPUT_METHOD_CONTEXT)
 
-static void input_purpose_changed_cb(WPEInputMethodContextGtk *context_gtk)
+static GtkInputPurpose gtk_input_purpose_for_wpe_input_purpose(WPEInputPurpose purpose)
 {
-  GtkInputPurpose gtk_purpose;
-  switch (wpe_input_method_context_get_input_purpose(WPE_INPUT_METHOD_CONTEXT(context_gtk))) {
+  GtkInputPurpose gtk_purpose = GTK_INPUT_PURPOSE_FREE_FORM;
+  switch (purpose) {
   case WPE_INPUT_PURPOSE_FREE_FORM:
     gtk_purpose = GTK_INPUT_PURPOSE_FREE_FORM;
     break;
@@ -75,12 +99,11 @@ static void input_purpose_changed_cb(WPEInputMethodContextGtk *context_gtk)
     break;
   }
 
-  g_object_set(context_gtk->im_context, "input-purpose", gtk_purpose, NULL);
+  return gtk_purpose;
 }
 
-static void input_hints_changed_cb(WPEInputMethodContextGtk *context_gtk)
+static GtkInputHints gtk_input_hints_for_wpe_input_hints(WPEInputHints hints)
 {
-  WPEInputHints hints = wpe_input_method_context_get_input_hints(WPE_INPUT_METHOD_CONTEXT(context_gtk));
   GtkInputHints gtk_hints = GTK_INPUT_HINT_NONE;
   if (hints & WPE_INPUT_HINT_SPELLCHECK)
     gtk_hints |= GTK_INPUT_HINT_SPELLCHECK;
@@ -107,21 +130,121 @@ static void input_hints_changed_cb(WPEInputMethodContextGtk *context_gtk)
   if (hints & WPE_INPUT_HINT_PRIVATE)
     gtk_hints |= GTK_INPUT_HINT_PRIVATE;
 
-  g_object_set(context_gtk->im_context, "input-hints", gtk_hints, NULL);
+  return gtk_hints;
+}
+
+static void wpe_input_method_context_gtk_flush(WPEInputMethodContextGtk *context_gtk)
+{
+  g_clear_handle_id(&context_gtk->flush_id, g_source_remove);
+
+  if (context_gtk->pending_state & PENDING_STATE_CURSOR_AREA) {
+    if (!context_gtk->cursor_area_applied || !gdk_rectangle_equal(&context_gtk->cursor_area, &context_gtk->applied_cursor_area)) {
+      context_gtk->applied_cursor_area = context_gtk->cursor_area;
+      context_gtk->cursor_area_applied = TRUE;
+      gtk_im_context_set_cursor_location(context_gtk->im_context, &context_gtk->applied_cursor_area);
+    }
+  }
+
+  if (context_gtk->pending_state & PENDING_STATE_PURPOSE) {
+    GtkInputPurpose gtk_purpose = gtk_input_purpose_for_wpe_input_purpose(wpe_input_method_context_get_input_purpose(WPE_INPUT_METHOD_CONTEXT(context_gtk)));
+    if (gtk_purpose != context_gtk->applied_purpose) {
+      context_gtk->applied_purpose = gtk_purpose;
+      g_object_set(context_gtk->im_context, "input-purpose", gtk_purpose, NULL);
+    }
+  }
+
+  if (context_gtk->pending_state & PENDING_STATE_HINTS) {
+    GtkInputHints gtk_hints = gtk_input_hints_for_wpe_input_hints(wpe_input_method_context_get_input_hints(WPE_INPUT_METHOD_CONTEXT(context_gtk)));
+    if (gtk_hints != context_gtk->applied_hints) {
+      context_gtk->applied_hints = gtk_hints;
+      g_object_set(context_gtk->im_context, "input-hints", gtk_hints, NULL);
+    }
+  }
+
+  context_gtk->pending_state = 0;
+}
+
+static gboolean flush_idle_cb(WPEInputMethodContextGtk *context_gtk)
+{
+  context_gtk->flush_id = 0;
+  wpe_input_method_context_gtk_flush(context_gtk);
+  return G_SOURCE_REMOVE;
+}
+
+static void wpe_input_method_context_gtk_schedule_flush(WPEInputMethodContextGtk *context_gtk, PendingState state)
+{
+  context_gtk->pending_state |= state;
+  if (!context_gtk->flush_id)
+    context_gtk->flush_id = g_idle_add_full(GDK_PRIORITY_REDRAW, (GSourceFunc)flush_idle_cb, context_gtk, NULL);
+}
+
+static void input_purpose_changed_cb(WPEInputMethodContextGtk *context_gtk)
+{
+  wpe_input_method_context_gtk_schedule_flush(context_gtk, PENDING_STATE_PURPOSE);
+}
+
+static void input_hints_changed_cb(WPEInputMethodContextGtk *context_gtk)
+{
+  wpe_input_method_context_gtk_schedule_flush(context_gtk, PENDING_STATE_HINTS);
+}
+
+static void wpe_input_method_context_gtk_invalidate_preedit(WPEInputMethodContextGtk *context_gtk)
+{
+  context_gtk->preedit_valid = FALSE;
+  g_clear_pointer(&context_gtk->preedit_text, g_free);
+  g_list_free_full(g_steal_pointer(&context_gtk->preedit_underlines), (GDestroyNotify)wpe_input_method_underline_free);
+  context_gtk->preedit_cursor_offset = 0;
+}
+
+static void wpe_input_method_context_gtk_update_preedit(WPEInputMethodContextGtk *context_gtk)
+{
+  PangoAttrList *attr_list = NULL;
+  int offset;
+  gtk_im_context_get_preedit_string(context_gtk->im_context, &context_gtk->preedit_text, &attr_list, &offset);
+  context_gtk->preedit_cursor_offset = offset;
+
+  if (attr_list) {
+    PangoAttrIterator *iter = pango_attr_list_get_iterator(attr_list);
+    do {
+      if (!pango_attr_iterator_get(iter, PANGO_ATTR_UNDERLINE))
+        continue;
+
+      int start, end;
+      pango_attr_iterator_range(iter, &start, &end);
+
+      WPEInputMethodUnderline *underline = wpe_input_method_underline_new(start, end);
+      PangoAttribute *color_attr = pango_attr_iterator_get(iter, PANGO_ATTR_UNDERLINE_COLOR);
+      if (color_attr) {
+        PangoColor *color = &((PangoAttrColor*)color_attr)->color;
+        WPEColor rgba = { color->red / 65535.f, color->green / 65535.f, color->blue / 65535.f, 1.f };
+        wpe_input_method_underline_set_color(underline, &rgba);
+      }
+
+      context_gtk->preedit_underlines = g_list_prepend(context_gtk->preedit_underlines, underline);
+    } while (pango_attr_iterator_next(iter));
+    pango_attr_iterator_destroy(iter);
+    pango_attr_list_unref(attr_list);
+  }
+  context_gtk->preedit_underlines = g_list_reverse(context_gtk->preedit_underlines);
+
+  context_gtk->preedit_valid = TRUE;
 }
 
 static void im_context_preedit_start_cb(WPEInputMethodContextGtk *context_gtk)
 {
+  wpe_input_method_context_gtk_invalidate_preedit(context_gtk);
   g_signal_emit_by_name(context_gtk, "preedit-started", NULL);
 }
 
 static void im_context_preedit_changed_cb(WPEInputMethodContextGtk *context_gtk)
 {
+  wpe_input_method_context_gtk_invalidate_preedit(context_gtk);
   g_signal_emit_by_name(context_gtk, "preedit-changed", NULL);
 }
 
 static void im_context_preedit_end_cb(WPEInputMethodContextGtk *context_gtk)
 {
+  wpe_input_method_context_gtk_invalidate_preedit(context_gtk);
   g_signal_emit_by_name(context_gtk, "preedit-finished", NULL);
 }
 
@@ -178,11 +301,32 @@ static void wpe_input_method_context_gtk_constructed(GObject *object)
     gtk_im_context_set_client_widget(context_gtk->im_context, wpe_view_gtk_get_widget(WPE_VIEW_GTK(view)));
 }
 
+static void wpe_input_method_context_gtk_set_focused(WPEInputMethodContextGtk *context_gtk, gboolean focused)
+{
+  if (context_gtk->focused == focused)
+    return;
+
+  context_gtk->focused = focused;
+  WPEView *view = wpe_input_method_context_get_view(WPE_INPUT_METHOD_CONTEXT(context_gtk));
+  WPEDrawingArea *area = view ? wpe_view_gtk_get_drawing_area(WPE_VIEW_GTK(view)) : NULL;
+  if (area)
+    wpe_drawing_area_set_input_method_enabled(area, focused);
+}
+
+static void wpe_input_method_context_gtk_dispose(GObject *object)
+{
+  wpe_input_method_context_gtk_set_focused(WPE_INPUT_METHOD_CONTEXT_GTK(object), FALSE);
+
+  G_OBJECT_CLASS(wpe_input_method_context_gtk_parent_class)->dispose(object);
+}
+
 static void wpe_input_method_context_gtk_finalize(GObject *object)
 {
   WPEInputMethodContextGtk *context_gtk = WPE_INPUT_METHOD_CONTEXT_GTK(object);
+  g_clear_handle_id(&context_gtk->flush_id, g_source_remove);
   g_clear_object(&context_gtk->im_context);
   g_free(context_gtk->surrounding_text);
+  wpe_input_method_context_gtk_invalidate_preedit(context_gtk);
 
   G_OBJECT_CLASS(wpe_input_method_context_gtk_parent_class)->finalize(object);
 }
@@ -190,76 +334,83 @@ static void wpe_input_method_context_gtk_finalize(GObject *object)
 static void wpe_input_method_context_gtk_get_preedit_string(WPEInputMethodContext *context, gchar **text, GList **underlines, guint *cursor_offset)
 {
   WPEInputMethodContextGtk *context_gtk = WPE_INPUT_METHOD_CONTEXT_GTK(context);
+  if (!context_gtk->preedit_valid)
+    wpe_input_method_context_gtk_update_preedit(context_gtk);
 
-  PangoAttrList* attr_list = NULL;
-  int offset;
-  gtk_im_context_get_preedit_string(context_gtk->im_context, text, underlines ? &attr_list : NULL, &offset);
-
-  if (underlines) {
-    *underlines = NULL;
-    if (attr_list) {
-      PangoAttrIterator *iter = pango_attr_list_get_iterator(attr_list);
-
-      do {
-        if (!pango_attr_iterator_get(iter, PANGO_ATTR_UNDERLINE))
-          continue;
-
-        int start, end;
-        pango_attr_iterator_range(iter, &start, &end);
-
-        WPEInputMethodUnderline *underline = wpe_input_method_underline_new(start, end);
-        PangoAttribute *color_attr = pango_attr_iterator_get(iter, PANGO_ATTR_UNDERLINE_COLOR);
-        if (color_attr) {
-          PangoColor *color = &((PangoAttrColor*)color_attr)->color;
-          WPEColor rgba = { color->red / 65535.f, color->green / 65535.f, color->blue / 65535.f, 1.f };
-          wpe_input_method_underline_set_color(underline, &rgba);
-        }
-
-	*underlines = g_list_prepend(*underlines, underline);
-      } while (pango_attr_iterator_next(iter));
-    }
-  }
+  if (text)
+    *text = g_strdup(context_gtk->preedit_text);
 
-  g_clear_pointer(&attr_list, pango_attr_list_unref);
+  if (underlines)
+    *underlines = g_list_copy_deep(context_gtk->preedit_underlines, (GCopyFunc)wpe_input_method_underline_copy, NULL);
 
   if (cursor_offset)
-    *cursor_offset = offset;
+    *cursor_offset = context_gtk->preedit_cursor_offset;
 }
 
 static gboolean wpe_input_method_context_gtk_filter_key_event(WPEInputMethodContext *context, WPEEvent *event)
 {
+  WPEInputMethodContextGtk *context_gtk = WPE_INPUT_METHOD_CONTEXT_GTK(context);
+  if (!context_gtk->focused)
+    return FALSE;
+
   gpointer gdk_event = wpe_event_get_user_data(event);
   if (!GDK_IS_EVENT(gdk_event))
     return FALSE;
 
-  WPEInputMethodContextGtk *context_gtk = WPE_INPUT_METHOD_CONTEXT_GTK(context);
+  wpe_input_method_context_gtk_flush(context_gtk);
   return gtk_im_context_filter_keypress(context_gtk->im_context, GDK_EVENT(gdk_event));
 }
 
 static void wpe_input_method_context_gtk_focus_in(WPEInputMethodContext *context)
 {
   WPEInputMethodContextGtk *context_gtk = WPE_INPUT_METHOD_CONTEXT_GTK(context);
+  wpe_input_method_context_gtk_set_focused(context_gtk, TRUE);
+  wpe_input_method_context_gtk_flush(context_gtk);
   gtk_im_context_focus_in(context_gtk->im_context);
 }
 
 static void wpe_input_method_context_gtk_focus_out(WPEInputMethodContext *context)
 {
   WPEInputMethodContextGtk *context_gtk = WPE_INPUT_METHOD_CONTEXT_GTK(context);
+  wpe_input_method_context_gtk_set_focused(context_gtk, FALSE);
   gtk_im_context_focus_out(context_gtk->im_context);
 }
 
 static void wpe_input_method_context_gtk_set_cursor_area(WPEInputMethodContext *context, int x, int y, int width, int height)
 {
   WPEInputMethodContextGtk *context_gtk = WPE_INPUT_METHOD_CONTEXT_GTK(context);
-  GdkRectangle cursor_rect = { x, y, width, height };
-  gtk_im_context_set_cursor_location(context_gtk->im_context, &cursor_rect);
+  context_gtk->cursor_area = (GdkRectangle) { x, y, width, height };
+  wpe_input_method_context_gtk_schedule_flush(context_gtk, PENDING_STATE_CURSOR_AREA);
 }
 
 static void wpe_input_method_context_gtk_set_surrounding(WPEInputMethodContext *context, const gchar *text, guint length, guint cursor_index, guint selection_index)
 {
   WPEInputMethodContextGtk *context_gtk = WPE_INPUT_METHOD_CONTEXT_GTK(context);
+
+  cursor_index = MIN(cursor_index, length);
+  selection_index = MIN(selection_index, length);
+  gsize start = MIN(cursor_index, selection_index);
+  gsize end = MAX(cursor_index, selection_index);
+  start = start > SURROUNDING_TEXT_CONTEXT_LENGTH ? start - SURROUNDING_TEXT_CONTEXT_LENGTH : 0;
+  end = MIN(end + SURROUNDING_TEXT_CONTEXT_LENGTH, length);
+  while (start > 0 && (text[start] & 0xc0) == 0x80)
+    start++;
+  while (end < length && (text[end] & 0xc0) == 0x80)
+    end--;
+
+  gsize window_length = end - start;
+  cursor_index -= start;
+  selection_index -= start;
+  if (context_gtk->surrounding_text
+      && context_gtk->surrounding_length == window_length
+      && context_gtk->surrounding_cursor_index == cursor_index
+      && context_gtk->surrounding_selection_index == selection_index
+      && !memcmp(context_gtk->surrounding_text, text + start, window_length))
+    return;
+
   g_free(context_gtk->surrounding_text);
-  context_gtk->surrounding_text = g_strndup(text, length);
+  context_gtk->surrounding_text = g_strndup(text + start, window_length);
+  context_gtk->surrounding_length = window_length;
   context_gtk->surrounding_cursor_index = cursor_index;
   context_gtk->surrounding_selection_index = selection_index;
 }
@@ -267,6 +418,7 @@ static void wpe_input_method_context_gtk_set_surrounding(WPEInputMethodContext *
 static void wpe_input_method_context_gtk_reset(WPEInputMethodContext *context)
 {
   WPEInputMethodContextGtk *context_gtk = WPE_INPUT_METHOD_CONTEXT_GTK(context);
+  wpe_input_method_context_gtk_flush(context_gtk);
   gtk_im_context_reset(context_gtk->im_context);
 }
 
@@ -274,6 +426,7 @@ static void wpe_input_method_context_gtk_class_init(WPEInputMethodContextGtkClas
 {
   GObjectClass *object_class = G_OBJECT_CLASS(klass);
   object_class->constructed = wpe_input_method_context_gtk_constructed;
+  object_class->dispose = wpe_input_method_context_gtk_dispose;
   object_class->finalize = wpe_input_method_context_gtk_finalize;
 
   WPEInputMethodContextClass *im_context_class = WPE_INPUT_METHOD_CONTEXT_CLASS(klass);
@@ -288,6 +441,8 @@ static void wpe_input_method_context_gtk_class_init(WPEInputMethodContextGtkClas
 
 static void wpe_input_method_context_gtk_init(WPEInputMethodContextGtk *context_gtk)
 {
+  context_gtk->applied_purpose = GTK_INPUT_PURPOSE_FREE_FORM;
+  context_gtk->applied_hints = GTK_INPUT_HINT_NONE;
 }
 
 WPEInputMethodContext *wpe_input_method_context_gtk_new(WPEView *view)
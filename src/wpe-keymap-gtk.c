@@ -22,10 +22,23 @@
 
 #include "wpe-keymap-gtk.h"
 
+typedef struct {
+  gint64 key;
+  gboolean translated;
+  guint keyval;
+  int effective_group;
+  int level;
+  WPEModifiers consumed_modifiers;
+} TranslatedKey;
+
 struct _WPEKeymapGtk {
   WPEKeymap parent;
 
   GdkDisplay *display;
+  GdkDevice *keyboard;
+  GHashTable *entries_for_keyval;
+  GHashTable *translated_keys;
+  WPEModifiers modifiers;
 };
 
 G_DEFINE_FINAL_TYPE(WPEKeymapGtk, wpe_keymap_gtk, WPE_TYPE_KEYMAP)
@@ -33,7 +46,12 @@ G_DEFINE_FINAL_TYPE(WPEKeymapGtk, wpe_keymap_gtk, WPE_TYPE_KEYMAP)
 static void wpe_keymap_gtk_finalize(GObject *object)
 {
   WPEKeymapGtk *keymap_gtk = WPE_KEYMAP_GTK(object);
+  if (keymap_gtk->keyboard)
+    g_signal_handlers_disconnect_by_data(keymap_gtk->keyboard, keymap_gtk);
+  g_clear_object(&keymap_gtk->keyboard);
   g_clear_object(&keymap_gtk->display);
+  g_clear_pointer(&keymap_gtk->entries_for_keyval, g_hash_table_unref);
+  g_clear_pointer(&keymap_gtk->translated_keys, g_hash_table_unref);
 
   G_OBJECT_CLASS(wpe_keymap_gtk_parent_class)->finalize(object);
 }
@@ -69,47 +87,83 @@ static WPEModifiers wpe_modifiers_from_gdk_modifiers(GdkModifierType state)
 static gboolean wpe_keymap_gtk_get_entries_for_keyval(WPEKeymap *keymap, guint keyval, WPEKeymapEntry **entries, guint *n_entries)
 {
   WPEKeymapGtk *keymap_gtk = WPE_KEYMAP_GTK(keymap);
-  GdkKeymapKey *gdk_entries = NULL;
-  int gdk_n_entries;
-  if (gdk_display_map_keyval(keymap_gtk->display, keyval, &gdk_entries, &gdk_n_entries)) {
-    *entries = g_new(WPEKeymapEntry, gdk_n_entries);
-    for (guint i = 0; i < *n_entries; i++) {
-      (*entries[i]).keycode = gdk_entries[i].keycode;
-      (*entries[i]).group = gdk_entries[i].group;
-      (*entries[i]).level = gdk_entries[i].level;
+  GArray *keyval_entries = g_hash_table_lookup(keymap_gtk->entries_for_keyval, GUINT_TO_POINTER(keyval));
+  if (!keyval_entries) {
+    keyval_entries = g_array_new(FALSE, FALSE, sizeof(WPEKeymapEntry));
+    GdkKeymapKey *gdk_entries = NULL;
+    int gdk_n_entries;
+    if (gdk_display_map_keyval(keymap_gtk->display, keyval, &gdk_entries, &gdk_n_entries)) {
+      g_array_set_size(keyval_entries, gdk_n_entries);
+      for (int i = 0; i < gdk_n_entries; i++) {
+        WPEKeymapEntry *entry = &g_array_index(keyval_entries, WPEKeymapEntry, i);
+        entry->keycode = gdk_entries[i].keycode;
+        entry->group = gdk_entries[i].group;
+        entry->level = gdk_entries[i].level;
+      }
+      g_free(gdk_entries);
     }
-    g_free(gdk_entries);
+    g_hash_table_insert(keymap_gtk->entries_for_keyval, GUINT_TO_POINTER(keyval), keyval_entries);
+  }
 
-    *n_entries = gdk_n_entries;
+  if (!keyval_entries->len)
+    return FALSE;
 
-    return TRUE;
-  }
+  *entries = g_memdup2(keyval_entries->data, keyval_entries->len * sizeof(WPEKeymapEntry));
+  *n_entries = keyval_entries->len;
 
-  return FALSE;
+  return TRUE;
+}
+
+static gint64 translated_key_hash_key(guint keycode, GdkModifierType state, int group)
+{
+  guint64 modifiers = 0;
+  if (state & GDK_SHIFT_MASK)
+    modifiers |= 1 << 0;
+  if (state & GDK_CONTROL_MASK)
+    modifiers |= 1 << 1;
+  if (state & GDK_ALT_MASK)
+    modifiers |= 1 << 2;
+  if (state & GDK_META_MASK)
+    modifiers |= 1 << 3;
+  return (gint64)((guint64)keycode | modifiers << 32 | (guint64)(guint16)group << 36);
 }
 
 static gboolean wpe_keymap_gtk_translate_keyboard_state(WPEKeymap *keymap, guint keycode, WPEModifiers modifiers, int group, guint *keyval, int *effective_group, int *level, WPEModifiers *consumed_modifiers)
 {
   WPEKeymapGtk *keymap_gtk = WPE_KEYMAP_GTK(keymap);
-  GdkModifierType gdk_consumed_modifiers;
-  if (!gdk_display_translate_key(keymap_gtk->display, keycode, wpe_modifiers_to_gdk_modifiers(modifiers), group, keyval, effective_group, level, consumed_modifiers ? &gdk_consumed_modifiers : NULL))
+  GdkModifierType state = wpe_modifiers_to_gdk_modifiers(modifiers);
+  gint64 key = translated_key_hash_key(keycode, state, group);
+  TranslatedKey *translated_key = g_hash_table_lookup(keymap_gtk->translated_keys, &key);
+  if (!translated_key) {
+    translated_key = g_new0(TranslatedKey, 1);
+    translated_key->key = key;
+
+    GdkModifierType gdk_consumed_modifiers;
+    translated_key->translated = gdk_display_translate_key(keymap_gtk->display, keycode, state, group, &translated_key->keyval,
+                                                           &translated_key->effective_group, &translated_key->level, &gdk_consumed_modifiers);
+    if (translated_key->translated)
+      translated_key->consumed_modifiers = wpe_modifiers_from_gdk_modifiers(gdk_consumed_modifiers);
+    g_hash_table_add(keymap_gtk->translated_keys, translated_key);
+  }
+
+  if (!translated_key->translated)
     return FALSE;
 
+  if (keyval)
+    *keyval = translated_key->keyval;
+  if (effective_group)
+    *effective_group = translated_key->effective_group;
+  if (level)
+    *level = translated_key->level;
   if (consumed_modifiers)
-    *consumed_modifiers = wpe_modifiers_from_gdk_modifiers(gdk_consumed_modifiers);
+    *consumed_modifiers = translated_key->consumed_modifiers;
 
   return TRUE;
 }
 
 static WPEModifiers wpe_keymap_gtk_get_modifiers(WPEKeymap *keymap)
 {
-  WPEKeymapGtk *keymap_gtk = WPE_KEYMAP_GTK(keymap);
-  GdkDevice *device = gdk_seat_get_keyboard(gdk_display_get_default_seat(keymap_gtk->display));
-  WPEModifiers modifiers = wpe_modifiers_from_gdk_modifiers(gdk_device_get_modifier_state(device));
-  if (gdk_device_get_caps_lock_state(device))
-    modifiers |= WPE_MODIFIER_KEYBOARD_CAPS_LOCK;
-
-  return modifiers;
+  return WPE_KEYMAP_GTK(keymap)->modifiers;
 }
 
 static void wpe_keymap_gtk_class_init(WPEKeymapGtkClass *klass)
@@ -125,6 +179,21 @@ static void wpe_keymap_gtk_class_init(WPEKeymapGtkClass *klass)
 
 static void wpe_keymap_gtk_init(WPEKeymapGtk *keymap_gtk)
 {
+  keymap_gtk->entries_for_keyval = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_array_unref);
+  keymap_gtk->translated_keys = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, g_free);
+}
+
+static void wpe_keymap_gtk_layout_changed(WPEKeymapGtk *keymap_gtk)
+{
+  g_hash_table_remove_all(keymap_gtk->entries_for_keyval);
+  g_hash_table_remove_all(keymap_gtk->translated_keys);
+}
+
+static void wpe_keymap_gtk_modifiers_changed(WPEKeymapGtk *keymap_gtk)
+{
+  keymap_gtk->modifiers = wpe_modifiers_from_gdk_modifiers(gdk_device_get_modifier_state(keymap_gtk->keyboard));
+  if (gdk_device_get_caps_lock_state(keymap_gtk->keyboard))
+    keymap_gtk->modifiers |= WPE_MODIFIER_KEYBOARD_CAPS_LOCK;
 }
 
 WPEKeymap *wpe_keymap_gtk_new(GdkDisplay *display)
@@ -133,5 +202,17 @@ WPEKeymap *wpe_keymap_gtk_new(GdkDisplay *display)
 
   WPEKeymapGtk *keymap = WPE_KEYMAP_GTK(g_object_new(WPE_TYPE_KEYMAP_GTK, NULL));
   keymap->display = g_object_ref(display);
+
+  GdkSeat *seat = gdk_display_get_default_seat(display);
+  GdkDevice *keyboard = seat ? gdk_seat_get_keyboard(seat) : NULL;
+  if (keyboard) {
+    keymap->keyboard = g_object_ref(keyboard);
+    wpe_keymap_gtk_modifiers_changed(keymap);
+    g_signal_connect_swapped(keyboard, "notify::layout-names", G_CALLBACK(wpe_keymap_gtk_layout_changed), keymap);
+    g_signal_connect_swapped(keyboard, "notify::active-layout-index", G_CALLBACK(wpe_keymap_gtk_layout_changed), keymap);
+    g_signal_connect_swapped(keyboard, "notify::modifier-state", G_CALLBACK(wpe_keymap_gtk_modifiers_changed), keymap);
+    g_signal_connect_swapped(keyboard, "notify::caps-lock-state", G_CALLBACK(wpe_keymap_gtk_modifiers_changed), keymap);
+  }
+
   return WPE_KEYMAP(keymap);
 }
@@ -25,3 +25,5 @@
 #include "wpe-screen-gtk.h"
 
 WPEScreen *wpe_screen_gtk_create(GdkMonitor *monitor);
+void wpe_screen_gtk_add_frame_clock(WPEScreenGtk *screen, GdkFrameClock *frame_clock);
+void wpe_screen_gtk_remove_frame_clock(WPEScreenGtk *screen, GdkFrameClock *frame_clock);
@@ -22,30 +22,90 @@
 
 #include "wpe-screen-gtk-private.h"
 
+#include "wpe-screen-sync-observer-gtk.h"
+
 struct _WPEScreenGtk {
   WPEScreen parent;
 
   GdkMonitor *monitor;
+  GPtrArray *frame_clocks;
+  WPEScreenSyncObserver *sync_observer;
 };
 
 G_DEFINE_FINAL_TYPE(WPEScreenGtk, wpe_screen_gtk, WPE_TYPE_SCREEN)
 
+static void wpe_screen_gtk_stop_sync_observer(WPEScreenGtk *screen_gtk)
+{
+  // The observer may outlive the screen, wake up its thread now.
+  if (screen_gtk->sync_observer)
+    wpe_screen_sync_observer_gtk_stop(WPE_SCREEN_SYNC_OBSERVER_GTK(screen_gtk->sync_observer));
+}
+
+static void wpe_screen_gtk_dispose(GObject *object)
+{
+  wpe_screen_gtk_stop_sync_observer(WPE_SCREEN_GTK(object));
+
+  G_OBJECT_CLASS(wpe_screen_gtk_parent_class)->dispose(object);
+}
+
 static void wpe_screen_gtk_finalize(GObject *object)
 {
   WPEScreenGtk *screen_gtk = WPE_SCREEN_GTK(object);
   g_clear_object(&screen_gtk->monitor);
+  g_clear_pointer(&screen_gtk->frame_clocks, g_ptr_array_unref);
+  g_clear_object(&screen_gtk->sync_observer);
 
   G_OBJECT_CLASS(wpe_screen_gtk_parent_class)->finalize(object);
 }
 
+static WPEScreenSyncObserver *wpe_screen_gtk_get_sync_observer(WPEScreen *screen)
+{
+  WPEScreenGtk *screen_gtk = WPE_SCREEN_GTK(screen);
+  if (!screen_gtk->sync_observer) {
+    screen_gtk->sync_observer = wpe_screen_sync_observer_gtk_new();
+    for (guint i = 0; i < screen_gtk->frame_clocks->len; i++)
+      wpe_screen_sync_observer_gtk_add_frame_clock(WPE_SCREEN_SYNC_OBSERVER_GTK(screen_gtk->sync_observer), g_ptr_array_index(screen_gtk->frame_clocks, i));
+  }
+
+  return screen_gtk->sync_observer;
+}
+
 static void wpe_screen_gtk_class_init(WPEScreenGtkClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS(klass);
+  object_class->dispose = wpe_screen_gtk_dispose;
   object_class->finalize = wpe_screen_gtk_finalize;
+
+  WPEScreenClass *screen_class = WPE_SCREEN_CLASS(klass);
+  screen_class->get_sync_observer = wpe_screen_gtk_get_sync_observer;
 }
 
 static void wpe_screen_gtk_init(WPEScreenGtk *screen_gtk)
 {
+  screen_gtk->frame_clocks = g_ptr_array_new_with_free_func(g_object_unref);
+}
+
+static void wpe_screen_gtk_update_geometry(WPEScreenGtk *screen_gtk)
+{
+  GdkRectangle geometry;
+  gdk_monitor_get_geometry(screen_gtk->monitor, &geometry);
+  wpe_screen_set_position(WPE_SCREEN(screen_gtk), geometry.x, geometry.y);
+  wpe_screen_set_size(WPE_SCREEN(screen_gtk), geometry.width, geometry.height);
+}
+
+static void wpe_screen_gtk_update_physical_size(WPEScreenGtk *screen_gtk)
+{
+  wpe_screen_set_physical_size(WPE_SCREEN(screen_gtk), gdk_monitor_get_width_mm(screen_gtk->monitor), gdk_monitor_get_height_mm(screen_gtk->monitor));
+}
+
+static void wpe_screen_gtk_update_scale(WPEScreenGtk *screen_gtk)
+{
+  wpe_screen_set_scale(WPE_SCREEN(screen_gtk), gdk_monitor_get_scale_factor(screen_gtk->monitor));
+}
+
+static void wpe_screen_gtk_update_refresh_rate(WPEScreenGtk *screen_gtk)
+{
+  wpe_screen_set_refresh_rate(WPE_SCREEN(screen_gtk), gdk_monitor_get_refresh_rate(screen_gtk->monitor));
 }
 
 WPEScreen *wpe_screen_gtk_create(GdkMonitor *monitor)
@@ -53,18 +113,43 @@ WPEScreen *wpe_screen_gtk_create(GdkMonitor *monitor)
   g_return_val_if_fail(GDK_IS_MONITOR(monitor), NULL);
 
   static guint screen_id = 0;
-  WPEScreen *screen = WPE_SCREEN(g_object_new(WPE_TYPE_SCREEN_GTK, "id", ++screen_id, NULL));
-  WPE_SCREEN_GTK(screen)->monitor = g_object_ref(monitor);
+  WPEScreenGtk *screen_gtk = WPE_SCREEN_GTK(g_object_new(WPE_TYPE_SCREEN_GTK, "id", ++screen_id, NULL));
+  screen_gtk->monitor = g_object_ref(monitor);
 
-  GdkRectangle geometry;
-  gdk_monitor_get_geometry(monitor, &geometry);
-  wpe_screen_set_position(screen, geometry.x, geometry.y);
-  wpe_screen_set_size(screen, geometry.width, geometry.height);
-  wpe_screen_set_physical_size(screen, gdk_monitor_get_width_mm(monitor), gdk_monitor_get_height_mm(monitor));
-  wpe_screen_set_scale(screen, gdk_monitor_get_scale_factor(monitor));
-  wpe_screen_set_refresh_rate(screen, gdk_monitor_get_refresh_rate(monitor));
-
-  return screen;
+  wpe_screen_gtk_update_geometry(screen_gtk);
+  wpe_screen_gtk_update_physical_size(screen_gtk);
+  wpe_screen_gtk_update_scale(screen_gtk);
+  wpe_screen_gtk_update_refresh_rate(screen_gtk);
+
+  g_signal_connect_object(monitor, "notify::geometry", G_CALLBACK(wpe_screen_gtk_update_geometry), screen_gtk, G_CONNECT_SWAPPED);
+  g_signal_connect_object(monitor, "notify::width-mm", G_CALLBACK(wpe_screen_gtk_update_physical_size), screen_gtk, G_CONNECT_SWAPPED);
+  g_signal_connect_object(monitor, "notify::height-mm", G_CALLBACK(wpe_screen_gtk_update_physical_size), screen_gtk, G_CONNECT_SWAPPED);
+  g_signal_connect_object(monitor, "notify::scale-factor", G_CALLBACK(wpe_screen_gtk_update_scale), screen_gtk, G_CONNECT_SWAPPED);
+  g_signal_connect_object(monitor, "notify::refresh-rate", G_CALLBACK(wpe_screen_gtk_update_refresh_rate), screen_gtk, G_CONNECT_SWAPPED);
+  g_signal_connect_object(monitor, "invalidate", G_CALLBACK(wpe_screen_gtk_stop_sync_observer), screen_gtk, G_CONNECT_SWAPPED);
+
+  return WPE_SCREEN(screen_gtk);
+}
+
+void wpe_screen_gtk_add_frame_clock(WPEScreenGtk *screen, GdkFrameClock *frame_clock)
+{
+  g_return_if_fail(WPE_IS_SCREEN_GTK(screen));
+  g_return_if_fail(GDK_IS_FRAME_CLOCK(frame_clock));
+
+  g_ptr_array_add(screen->frame_clocks, g_object_ref(frame_clock));
+  if (screen->sync_observer)
+    wpe_screen_sync_observer_gtk_add_frame_clock(WPE_SCREEN_SYNC_OBSERVER_GTK(screen->sync_observer), frame_clock);
+}
+
+void wpe_screen_gtk_remove_frame_clock(WPEScreenGtk *screen, GdkFrameClock *frame_clock)
+{
+  g_return_if_fail(WPE_IS_SCREEN_GTK(screen));
+
+  if (!g_ptr_array_remove(screen->frame_clocks, frame_clock))
+    return;
+
+  if (screen->sync_observer && !g_ptr_array_find(screen->frame_clocks, frame_clock, NULL))
+    wpe_screen_sync_observer_gtk_remove_frame_clock(WPE_SCREEN_SYNC_OBSERVER_GTK(screen->sync_observer), frame_clock);
 }
 
 GdkMonitor *wpe_screen_gtk_get_gdk_monitor(WPEScreenGtk *screen)
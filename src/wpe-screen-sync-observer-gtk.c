@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2026 Igalia S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "wpe-screen-sync-observer-gtk.h"
+
+// While a toplevel is on the screen but not painting, a new frame is requested
+// at this interval in case the previous request was lost.
+#define FRAME_REQUEST_INTERVAL_USEC G_USEC_PER_SEC
+
+struct _WPEScreenSyncObserverGtk {
+  WPEScreenSyncObserver parent;
+
+  GPtrArray *frame_clocks;
+  gint64 last_frame_time;
+
+  GMutex mutex;
+  GCond cond;
+  guint64 frame_counter;
+  guint frame_clocks_serial;
+  gboolean has_frame_clocks;
+  gboolean stopped;
+};
+
+G_DEFINE_FINAL_TYPE(WPEScreenSyncObserverGtk, wpe_screen_sync_observer_gtk, WPE_TYPE_SCREEN_SYNC_OBSERVER)
+
+static void frame_clock_update_cb(GdkFrameClock *frame_clock, WPEScreenSyncObserverGtk *observer_gtk)
+{
+  // Toplevels on the same screen are updated on the same vblank, only the
+  // first update of each frame is a tick.
+  gint64 frame_time = gdk_frame_clock_get_frame_time(frame_clock);
+  gint64 refresh_interval;
+  gdk_frame_clock_get_refresh_info(frame_clock, frame_time, &refresh_interval, NULL);
+  if (observer_gtk->last_frame_time && frame_time - observer_gtk->last_frame_time < refresh_interval / 2)
+    return;
+  observer_gtk->last_frame_time = frame_time;
+
+  g_mutex_lock(&observer_gtk->mutex);
+  observer_gtk->frame_counter++;
+  g_cond_broadcast(&observer_gtk->cond);
+  g_mutex_unlock(&observer_gtk->mutex);
+}
+
+static void wpe_screen_sync_observer_gtk_frame_clocks_changed(WPEScreenSyncObserverGtk *observer_gtk)
+{
+  g_mutex_lock(&observer_gtk->mutex);
+  observer_gtk->has_frame_clocks = observer_gtk->frame_clocks->len > 0;
+  observer_gtk->frame_clocks_serial++;
+  g_cond_broadcast(&observer_gtk->cond);
+  g_mutex_unlock(&observer_gtk->mutex);
+}
+
+static void wpe_screen_sync_observer_gtk_dispose(GObject *object)
+{
+  wpe_screen_sync_observer_gtk_stop(WPE_SCREEN_SYNC_OBSERVER_GTK(object));
+
+  G_OBJECT_CLASS(wpe_screen_sync_observer_gtk_parent_class)->dispose(object);
+}
+
+static void wpe_screen_sync_observer_gtk_finalize(GObject *object)
+{
+  WPEScreenSyncObserverGtk *observer_gtk = WPE_SCREEN_SYNC_OBSERVER_GTK(object);
+  g_ptr_array_unref(observer_gtk->frame_clocks);
+  g_mutex_clear(&observer_gtk->mutex);
+  g_cond_clear(&observer_gtk->cond);
+
+  G_OBJECT_CLASS(wpe_screen_sync_observer_gtk_parent_class)->finalize(object);
+}
+
+static gboolean request_frame_cb(WPEScreenSyncObserverGtk *observer_gtk)
+{
+  for (guint i = 0; i < observer_gtk->frame_clocks->len; i++)
+    gdk_frame_clock_request_phase(g_ptr_array_index(observer_gtk->frame_clocks, i), GDK_FRAME_CLOCK_PHASE_UPDATE);
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean wpe_screen_sync_observer_gtk_sync(WPEScreenSyncObserver *observer, GError **error)
+{
+  WPEScreenSyncObserverGtk *observer_gtk = WPE_SCREEN_SYNC_OBSERVER_GTK(observer);
+
+  // Block until a frame clock of a toplevel on the screen paints. While no
+  // toplevel is on the screen, or their clocks are frozen, there are no ticks.
+  g_mutex_lock(&observer_gtk->mutex);
+  guint64 frame_counter = observer_gtk->frame_counter;
+  guint frame_clocks_serial = observer_gtk->frame_clocks_serial;
+  gint64 request_time = 0;
+  while (observer_gtk->frame_counter == frame_counter && !observer_gtk->stopped) {
+    gint64 now = g_get_monotonic_time();
+    if (observer_gtk->has_frame_clocks && (!request_time || now >= request_time + FRAME_REQUEST_INTERVAL_USEC || frame_clocks_serial != observer_gtk->frame_clocks_serial)) {
+      request_time = now;
+      frame_clocks_serial = observer_gtk->frame_clocks_serial;
+      g_main_context_invoke_full(NULL, G_PRIORITY_DEFAULT, (GSourceFunc)request_frame_cb, g_object_ref(observer_gtk), g_object_unref);
+    }
+    g_cond_wait_until(&observer_gtk->cond, &observer_gtk->mutex, now + FRAME_REQUEST_INTERVAL_USEC);
+  }
+  gboolean stopped = observer_gtk->stopped;
+  g_mutex_unlock(&observer_gtk->mutex);
+
+  if (stopped) {
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_CANCELLED, "Screen sync observer was stopped");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void wpe_screen_sync_observer_gtk_class_init(WPEScreenSyncObserverGtkClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS(klass);
+  object_class->dispose = wpe_screen_sync_observer_gtk_dispose;
+  object_class->finalize = wpe_screen_sync_observer_gtk_finalize;
+
+  WPEScreenSyncObserverClass *observer_class = WPE_SCREEN_SYNC_OBSERVER_CLASS(klass);
+  observer_class->sync = wpe_screen_sync_observer_gtk_sync;
+}
+
+static void wpe_screen_sync_observer_gtk_init(WPEScreenSyncObserverGtk *observer_gtk)
+{
+  observer_gtk->frame_clocks = g_ptr_array_new_with_free_func(g_object_unref);
+  g_mutex_init(&observer_gtk->mutex);
+  g_cond_init(&observer_gtk->cond);
+}
+
+WPEScreenSyncObserver *wpe_screen_sync_observer_gtk_new(void)
+{
+  return WPE_SCREEN_SYNC_OBSERVER(g_object_new(WPE_TYPE_SCREEN_SYNC_OBSERVER_GTK, NULL));
+}
+
+void wpe_screen_sync_observer_gtk_add_frame_clock(WPEScreenSyncObserverGtk *observer, GdkFrameClock *frame_clock)
+{
+  g_return_if_fail(WPE_IS_SCREEN_SYNC_OBSERVER_GTK(observer));
+  g_return_if_fail(GDK_IS_FRAME_CLOCK(frame_clock));
+
+  if (observer->stopped || g_ptr_array_find(observer->frame_clocks, frame_clock, NULL))
+    return;
+
+  g_ptr_array_add(observer->frame_clocks, g_object_ref(frame_clock));
+  g_signal_connect(frame_clock, "update", G_CALLBACK(frame_clock_update_cb), observer);
+  wpe_screen_sync_observer_gtk_frame_clocks_changed(observer);
+}
+
+void wpe_screen_sync_observer_gtk_remove_frame_clock(WPEScreenSyncObserverGtk *observer, GdkFrameClock *frame_clock)
+{
+  g_return_if_fail(WPE_IS_SCREEN_SYNC_OBSERVER_GTK(observer));
+
+  guint index;
+  if (!g_ptr_array_find(observer->frame_clocks, frame_clock, &index))
+    return;
+
+  g_signal_handlers_disconnect_by_data(frame_clock, observer);
+  g_ptr_array_remove_index_fast(observer->frame_clocks, index);
+  wpe_screen_sync_observer_gtk_frame_clocks_changed(observer);
+}
+
+void wpe_screen_sync_observer_gtk_stop(WPEScreenSyncObserverGtk *observer)
+{
+  g_return_if_fail(WPE_IS_SCREEN_SYNC_OBSERVER_GTK(observer));
+
+  for (guint i = 0; i < observer->frame_clocks->len; i++)
+    g_signal_handlers_disconnect_by_data(g_ptr_array_index(observer->frame_clocks, i), observer);
+  g_ptr_array_set_size(observer->frame_clocks, 0);
+
+  g_mutex_lock(&observer->mutex);
+  observer->has_frame_clocks = FALSE;
+  observer->stopped = TRUE;
+  g_cond_broadcast(&observer->cond);
+  g_mutex_unlock(&observer->mutex);
+}
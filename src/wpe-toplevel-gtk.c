@@ -23,8 +23,9 @@
 #include "config.h"
 #include "wpe-toplevel-gtk.h"
 
+#include "wpe-display-gtk-private.h"
 #include "wpe-drawing-area.h"
-#include "wpe-screen-gtk.h"
+#include "wpe-screen-gtk-private.h"
 
 enum {
   PROP_0,
@@ -43,6 +44,8 @@ struct _WPEToplevelGtk {
   GdkToplevelState state;
   GList *monitors;
   GdkMonitor *current_monitor;
+  WPEScreen *frame_clock_screen;
+  GdkFrameClock *frame_clock;
 };
 
 G_DEFINE_FINAL_TYPE(WPEToplevelGtk, wpe_toplevel_gtk, WPE_TYPE_TOPLEVEL)
@@ -78,11 +81,30 @@ static void wpe_toplevel_gtk_state_changed(GdkSurface *surface, GParamSpec *pspe
   wpe_toplevel_state_changed(WPE_TOPLEVEL(toplevel_gtk), state);
 }
 
+static void wpe_toplevel_gtk_update_frame_clock(WPEToplevelGtk *toplevel_gtk, GdkSurface *surface)
+{
+  GdkFrameClock *frame_clock = surface ? gdk_surface_get_frame_clock(surface) : NULL;
+  WPEScreen *screen = frame_clock ? wpe_display_gtk_get_screen_for_monitor(WPE_DISPLAY_GTK(wpe_toplevel_get_display(WPE_TOPLEVEL(toplevel_gtk))), toplevel_gtk->current_monitor) : NULL;
+  if (!screen)
+    frame_clock = NULL;
+
+  if (screen == toplevel_gtk->frame_clock_screen && frame_clock == toplevel_gtk->frame_clock)
+    return;
+
+  if (toplevel_gtk->frame_clock_screen)
+    wpe_screen_gtk_remove_frame_clock(WPE_SCREEN_GTK(toplevel_gtk->frame_clock_screen), toplevel_gtk->frame_clock);
+  g_set_object(&toplevel_gtk->frame_clock_screen, screen);
+  g_set_object(&toplevel_gtk->frame_clock, frame_clock);
+  if (toplevel_gtk->frame_clock_screen)
+    wpe_screen_gtk_add_frame_clock(WPE_SCREEN_GTK(toplevel_gtk->frame_clock_screen), toplevel_gtk->frame_clock);
+}
+
 static void wpe_toplevel_gtk_entered_monitor(GdkSurface *surface, GdkMonitor *monitor, WPEToplevelGtk *toplevel_gtk)
 {
   toplevel_gtk->monitors = g_list_append(toplevel_gtk->monitors, monitor);
   if (toplevel_gtk->current_monitor != monitor) {
     toplevel_gtk->current_monitor = monitor;
+    wpe_toplevel_gtk_update_frame_clock(toplevel_gtk, surface);
     wpe_toplevel_screen_changed(WPE_TOPLEVEL(toplevel_gtk));
   }
 }
@@ -96,6 +118,7 @@ static void wpe_toplevel_gtk_left_monitor(GdkSurface *surface, GdkMonitor *monit
     current_monitor = gdk_display_get_monitor_at_surface(gtk_widget_get_display(GTK_WIDGET(toplevel_gtk->window)), surface);
   if (toplevel_gtk->current_monitor != current_monitor) {
     toplevel_gtk->current_monitor = current_monitor;
+    wpe_toplevel_gtk_update_frame_clock(toplevel_gtk, surface);
     wpe_toplevel_screen_changed(WPE_TOPLEVEL(toplevel_gtk));
   }
 }
@@ -107,6 +130,7 @@ static void wpe_toplevel_gtk_connect_surface_signals(WPEToplevelGtk *toplevel_gt
   g_signal_connect(surface, "notify::state", G_CALLBACK(wpe_toplevel_gtk_state_changed), toplevel_gtk);
 
   toplevel_gtk->current_monitor = gdk_display_get_monitor_at_surface(gtk_widget_get_display(GTK_WIDGET(toplevel_gtk->window)), surface);
+  wpe_toplevel_gtk_update_frame_clock(toplevel_gtk, surface);
   if (toplevel_gtk->current_monitor)
     wpe_toplevel_screen_changed(WPE_TOPLEVEL(toplevel_gtk));
   g_signal_connect(surface, "enter-monitor", G_CALLBACK(wpe_toplevel_gtk_entered_monitor), toplevel_gtk);
@@ -117,6 +141,7 @@ static void wpe_toplevel_gtk_disconnect_surface_signals(WPEToplevelGtk *toplevel
 {
   GdkSurface *surface = gtk_native_get_surface(GTK_NATIVE(toplevel_gtk->window));
   g_signal_handlers_disconnect_by_data(surface, toplevel_gtk);
+  wpe_toplevel_gtk_update_frame_clock(toplevel_gtk, NULL);
 }
 
 static void wpe_toplevel_gtk_realized(WPEToplevelGtk *toplevel_gtk)
@@ -184,6 +209,7 @@ static void wpe_toplevel_gtk_finalize(GObject *object)
       wpe_toplevel_gtk_disconnect_surface_signals(toplevel_gtk);
     g_object_remove_weak_pointer(G_OBJECT(toplevel_gtk->window), (gpointer*)&toplevel_gtk->window);
   }
+  wpe_toplevel_gtk_update_frame_clock(toplevel_gtk, NULL);
 
   G_OBJECT_CLASS(wpe_toplevel_gtk_parent_class)->finalize(object);
 }
@@ -204,15 +230,7 @@ static WPEScreen *wpe_toplevel_gtk_get_screen(WPEToplevel *toplevel)
   if (!toplevel_gtk->current_monitor)
     return NULL;
 
-  WPEDisplay *display = wpe_toplevel_get_display(toplevel);
-  guint n_screens = wpe_display_get_n_screens(display);
-  for (guint i = 0; i < n_screens; i++) {
-    WPEScreen *screen = wpe_display_get_screen(display, i);
-    if (wpe_screen_gtk_get_gdk_monitor(WPE_SCREEN_GTK(screen)) == toplevel_gtk->current_monitor)
-      return screen;
-  }
-
-  return NULL;
+  return wpe_display_gtk_get_screen_for_monitor(WPE_DISPLAY_GTK(wpe_toplevel_get_display(toplevel)), toplevel_gtk->current_monitor);
 }
 
 static gboolean wpe_toplevel_gtk_set_fullscreen(WPEToplevel *toplevel, gboolean fullscreen)
@@ -21,21 +21,84 @@
  */
 
 #include "config.h"
-#include "wpe-view-gtk.h"
+#include "wpe-view-gtk-private.h"
 
-#include "wpe-drawing-area.h"
+#include "wpe-display-gtk-private.h"
 #include "wpe-screen-gtk.h"
 #include "wpe-toplevel-gtk.h"
+#include <string.h>
+
+#define CURSOR_CACHE_SIZE 16
+
+typedef struct {
+  char *name;
+  GBytes *bytes;
+  guint hash;
+  guint width;
+  guint height;
+  guint stride;
+  guint hotspot_x;
+  guint hotspot_y;
+  GdkCursor *cursor;
+} CachedCursor;
 
 struct _WPEViewGtk {
   WPEView parent;
 
   WPEDrawingArea *drawing_area;
   GtkWidget *offload;
+
+  GQueue cursor_cache;
 };
 
 G_DEFINE_FINAL_TYPE(WPEViewGtk, wpe_view_gtk, WPE_TYPE_VIEW)
 
+static void cached_cursor_free(CachedCursor *cached_cursor)
+{
+  g_free(cached_cursor->name);
+  g_clear_pointer(&cached_cursor->bytes, g_bytes_unref);
+  g_clear_object(&cached_cursor->cursor);
+  g_free(cached_cursor);
+}
+
+static gboolean cached_cursor_equal(const CachedCursor *a, const CachedCursor *b)
+{
+  if (a->name || b->name)
+    return !g_strcmp0(a->name, b->name);
+
+  return a->hash == b->hash
+    && a->width == b->width
+    && a->height == b->height
+    && a->stride == b->stride
+    && a->hotspot_x == b->hotspot_x
+    && a->hotspot_y == b->hotspot_y
+    && g_bytes_equal(a->bytes, b->bytes);
+}
+
+static GdkCursor *wpe_view_gtk_lookup_cursor(WPEViewGtk *view_gtk, const CachedCursor *key)
+{
+  for (GList *link = view_gtk->cursor_cache.head; link; link = link->next) {
+    CachedCursor *cached_cursor = link->data;
+    if (!cached_cursor_equal(cached_cursor, key))
+      continue;
+
+    if (link != view_gtk->cursor_cache.head) {
+      g_queue_unlink(&view_gtk->cursor_cache, link);
+      g_queue_push_head_link(&view_gtk->cursor_cache, link);
+    }
+    return cached_cursor->cursor;
+  }
+
+  return NULL;
+}
+
+static void wpe_view_gtk_cache_cursor(WPEViewGtk *view_gtk, CachedCursor *cached_cursor)
+{
+  g_queue_push_head(&view_gtk->cursor_cache, cached_cursor);
+  if (view_gtk->cursor_cache.length > CURSOR_CACHE_SIZE)
+    cached_cursor_free(g_queue_pop_tail(&view_gtk->cursor_cache));
+}
+
 static void wpe_view_gtk_monitor_changed(WPEView *view, GParamSpec *pspec, gpointer user_data)
 {
   if (wpe_view_get_screen(view))
@@ -67,6 +130,7 @@ static void wpe_view_gtk_constructed(GObject *object)
   G_OBJECT_CLASS(wpe_view_gtk_parent_class)->constructed(object);
 
   WPEViewGtk *view_gtk = WPE_VIEW_GTK(object);
+  wpe_display_gtk_add_view(WPE_DISPLAY_GTK(wpe_view_get_display(WPE_VIEW(view_gtk))), WPE_VIEW(view_gtk));
   g_signal_connect(view_gtk, "notify::monitor", G_CALLBACK(wpe_view_gtk_monitor_changed), NULL);
   g_signal_connect(view_gtk, "notify::toplevel", G_CALLBACK(wpe_view_gtk_toplevel_changed), NULL);
 }
@@ -74,10 +138,12 @@ static void wpe_view_gtk_constructed(GObject *object)
 static void wpe_view_gtk_finalize(GObject *object)
 {
   WPEViewGtk *view_gtk = WPE_VIEW_GTK(object);
+  wpe_display_gtk_remove_view(WPE_DISPLAY_GTK(wpe_view_get_display(WPE_VIEW(view_gtk))), WPE_VIEW(view_gtk));
   if (view_gtk->drawing_area)
     g_object_remove_weak_pointer(G_OBJECT(view_gtk->drawing_area), (gpointer*)&view_gtk->drawing_area);
   if (view_gtk->offload)
     g_object_remove_weak_pointer(G_OBJECT(view_gtk->offload), (gpointer*)&view_gtk->offload);
+  g_queue_clear_full(&view_gtk->cursor_cache, (GDestroyNotify)cached_cursor_free);
 
   G_OBJECT_CLASS(wpe_view_gtk_parent_class)->finalize(object);
 }
@@ -99,7 +165,28 @@ static void wpe_view_gtk_set_cursor_from_name(WPEView *view, const char *name)
   if (!view_gtk->drawing_area)
     return;
 
-  gtk_widget_set_cursor_from_name(GTK_WIDGET(view_gtk->drawing_area), name);
+  if (!name) {
+    gtk_widget_set_cursor(GTK_WIDGET(view_gtk->drawing_area), NULL);
+    return;
+  }
+
+  CachedCursor key = { .name = (char *)name };
+  GdkCursor *cursor = wpe_view_gtk_lookup_cursor(view_gtk, &key);
+  if (!cursor) {
+    // Unknown names are not cached, they would push real cursors out.
+    cursor = gdk_cursor_new_from_name(name, NULL);
+    if (!cursor) {
+      gtk_widget_set_cursor(GTK_WIDGET(view_gtk->drawing_area), NULL);
+      return;
+    }
+
+    CachedCursor *cached_cursor = g_new0(CachedCursor, 1);
+    cached_cursor->name = g_strdup(name);
+    cached_cursor->cursor = cursor;
+    wpe_view_gtk_cache_cursor(view_gtk, cached_cursor);
+  }
+
+  gtk_widget_set_cursor(GTK_WIDGET(view_gtk->drawing_area), cursor);
 }
 
 static void wpe_view_gtk_set_cursor_from_bytes(WPEView *view, GBytes *bytes, guint width, guint height, guint stride, guint hotspot_x, guint hotspot_y)
@@ -108,8 +195,25 @@ static void wpe_view_gtk_set_cursor_from_bytes(WPEView *view, GBytes *bytes, gui
   if (!view_gtk->drawing_area)
     return;
 
-  g_autoptr(GdkTexture) texture = gdk_memory_texture_new(width, height, GDK_MEMORY_DEFAULT, bytes, stride);
-  g_autoptr(GdkCursor) cursor = gdk_cursor_new_from_texture(texture, hotspot_x, hotspot_y, NULL);
+  CachedCursor key = {
+    .bytes = bytes,
+    .hash = g_bytes_hash(bytes),
+    .width = width,
+    .height = height,
+    .stride = stride,
+    .hotspot_x = hotspot_x,
+    .hotspot_y = hotspot_y
+  };
+  GdkCursor *cursor = wpe_view_gtk_lookup_cursor(view_gtk, &key);
+  if (!cursor) {
+    g_autoptr(GdkTexture) texture = gdk_memory_texture_new(width, height, GDK_MEMORY_DEFAULT, bytes, stride);
+    CachedCursor *cached_cursor = g_memdup2(&key, sizeof(CachedCursor));
+    cached_cursor->bytes = g_bytes_ref(bytes);
+    cached_cursor->cursor = gdk_cursor_new_from_texture(texture, hotspot_x, hotspot_y, NULL);
+    wpe_view_gtk_cache_cursor(view_gtk, cached_cursor);
+    cursor = cached_cursor->cursor;
+  }
+
   gtk_widget_set_cursor(GTK_WIDGET(view_gtk->drawing_area), cursor);
 }
 
@@ -195,6 +299,13 @@ GtkWidget *wpe_view_gtk_get_widget(WPEViewGtk *view)
   return view->offload;
 }
 
+WPEDrawingArea *wpe_view_gtk_get_drawing_area(WPEViewGtk *view)
+{
+  g_return_val_if_fail(WPE_IS_VIEW_GTK(view), NULL);
+
+  return view->drawing_area;
+}
+
 void wpe_view_gtk_show_context_menu(WPEViewGtk *view, GMenuModel *menu, GActionGroup *group, GdkRectangle *rect)
 {
   g_return_if_fail(WPE_IS_VIEW_GTK(view));
@@ -204,3 +315,13 @@ void wpe_view_gtk_show_context_menu(WPEViewGtk *view, GMenuModel *menu, GActionG
   if (view->drawing_area)
     wpe_drawing_area_show_context_menu(view->drawing_area, menu, group, rect);
 }
+
+void wpe_view_gtk_get_memory_usage(WPEViewGtk *view, WPEMemoryUsageGtk *usage)
+{
+  g_return_if_fail(WPE_IS_VIEW_GTK(view));
+  g_return_if_fail(usage);
+
+  memset(usage, 0, sizeof(WPEMemoryUsageGtk));
+  if (view->drawing_area)
+    wpe_drawing_area_add_memory_usage(view->drawing_area, usage);
+}
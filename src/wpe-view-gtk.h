@@ -47,6 +47,10 @@ void       wpe_view_gtk_show_context_menu (WPEViewGtk    *view,
                                            GActionGroup  *group,
                                            GdkRectangle  *rect);
 
+WPE_PLATFORM_GTK_AVAILABLE_IN_ALL
+void       wpe_view_gtk_get_memory_usage  (WPEViewGtk        *view,
+                                           WPEMemoryUsageGtk *usage);
+
 G_END_DECLS
 
 #endif /* _WPE_VIEW_GTK_H_ */